@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "array.h"
+#include "obj.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Load-time benchmark of the OBJ parser
+///////////////////////////////////////////////////////////////////////////////
+// Loads every OBJ file given on the command line with the memory-mapped
+// parser and with the previous fgets/sscanf loader, checks that both read
+// the same vertices and faces, and reports the load rate of each in MB/s.
+//
+// Usage: ./bench_obj [iterations] file.obj...
+///////////////////////////////////////////////////////////////////////////////
+#define DEFAULT_ITERATIONS 10
+
+// Loader used before load_obj_file, kept here for comparison
+static bool legacy_load_obj_file(const char* filename, vec3_t** vertices, face_t** faces) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        return false;
+    }
+    char line[1024];
+    tex2_t* texcoords = NULL;
+
+    while (fgets(line, 1024, file)) {
+        if (strncmp(line, "v ", 2) == 0) {
+            vec3_t vertex;
+            sscanf(line, "v %f %f %f", &vertex.x, &vertex.y, &vertex.z);
+            array_push(*vertices, vertex);
+        } else if (strncmp(line, "vt ", 3) == 0) {
+            tex2_t texcoord;
+            sscanf(line, "vt %f %f", &texcoord.u, &texcoord.v);
+            array_push(texcoords, texcoord);
+        } else if (strncmp(line, "f ", 2) == 0) {
+            int v[4], vt[4], vn[4];
+            int count = sscanf(
+                line, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+                &v[0], &vt[0], &vn[0],
+                &v[1], &vt[1], &vn[1],
+                &v[2], &vt[2], &vn[2],
+                &v[3], &vt[3], &vn[3]
+            );
+            if (count == 9 || count == 12) {
+                face_t face = { v[0], v[1], v[2], texcoords[vt[0] - 1], texcoords[vt[1] - 1], texcoords[vt[2] - 1], 0xFFFFFFFF };
+                array_push(*faces, face);
+            }
+            if (count == 12) {
+                face_t face = { v[0], v[2], v[3], texcoords[vt[0] - 1], texcoords[vt[2] - 1], texcoords[vt[3] - 1], 0xFFFFFFFF };
+                array_push(*faces, face);
+            }
+        }
+    }
+    array_free(texcoords);
+    fclose(file);
+    return true;
+}
+
+typedef bool (*obj_loader_t)(const char* filename, vec3_t** vertices, face_t** faces);
+
+static double seconds_since(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double time_loader(obj_loader_t loader, const char* filename, int iterations) {
+    clock_t start = clock();
+    for (int it = 0; it < iterations; it++) {
+        vec3_t* vertices = NULL;
+        face_t* faces = NULL;
+        loader(filename, &vertices, &faces);
+        array_free(vertices);
+        array_free(faces);
+    }
+    return seconds_since(start) / iterations;
+}
+
+static bool is_same_face(face_t* a, face_t* b) {
+    return a->a == b->a && a->b == b->b && a->c == b->c &&
+        memcmp(&a->a_uv, &b->a_uv, sizeof(tex2_t)) == 0 &&
+        memcmp(&a->b_uv, &b->b_uv, sizeof(tex2_t)) == 0 &&
+        memcmp(&a->c_uv, &b->c_uv, sizeof(tex2_t)) == 0;
+}
+
+int main(int argc, char* argv[]) {
+    int first_file = 1;
+    int iterations = DEFAULT_ITERATIONS;
+    if (argc > 1 && atoi(argv[1]) > 0) {
+        iterations = atoi(argv[1]);
+        first_file = 2;
+    }
+
+    double total_megabytes = 0, total_legacy_time = 0, total_mapped_time = 0;
+    printf("%-24s %8s %8s %8s  %10s %10s %7s  %s\n", "file", "KB", "vertices", "faces", "sscanf", "mapped", "speedup", "check");
+
+    for (int i = first_file; i < argc; i++) {
+        const char* filename = argv[i];
+        FILE* file = fopen(filename, "rb");
+        if (file == NULL) {
+            fprintf(stderr, "Error opening %s.\n", filename);
+            continue;
+        }
+        fseek(file, 0, SEEK_END);
+        double megabytes = (double)ftell(file) / (1024 * 1024);
+        fclose(file);
+
+        // Both loaders must read the same vertices and faces, bit for bit
+        vec3_t* legacy_vertices = NULL;
+        face_t* legacy_faces = NULL;
+        vec3_t* vertices = NULL;
+        face_t* faces = NULL;
+        legacy_load_obj_file(filename, &legacy_vertices, &legacy_faces);
+        load_obj_file(filename, &vertices, &faces);
+        int num_mismatches = abs(array_length(vertices) - array_length(legacy_vertices)) + abs(array_length(faces) - array_length(legacy_faces));
+        for (int j = 0; j < array_length(vertices) && j < array_length(legacy_vertices); j++) {
+            num_mismatches += memcmp(&vertices[j], &legacy_vertices[j], sizeof(vec3_t)) != 0;
+        }
+        for (int j = 0; j < array_length(faces) && j < array_length(legacy_faces); j++) {
+            num_mismatches += !is_same_face(&faces[j], &legacy_faces[j]);
+        }
+
+        double legacy_time = time_loader(legacy_load_obj_file, filename, iterations);
+        double mapped_time = time_loader(load_obj_file, filename, iterations);
+        total_megabytes += megabytes;
+        total_legacy_time += legacy_time;
+        total_mapped_time += mapped_time;
+
+        const char* name = strrchr(filename, '/') ? strrchr(filename, '/') + 1 : filename;
+        printf("%-24s %8.0f %8d %8d  %5.1f MB/s %5.1f MB/s %6.1fx  %s\n",
+            name, megabytes * 1024, array_length(vertices), array_length(faces),
+            megabytes / legacy_time, megabytes / mapped_time, legacy_time / mapped_time,
+            num_mismatches == 0 ? "same" : "DIFFERENT");
+
+        array_free(legacy_vertices);
+        array_free(legacy_faces);
+        array_free(vertices);
+        array_free(faces);
+    }
+
+    if (total_mapped_time > 0) {
+        printf("%-24s %8.0f %8s %8s  %5.1f MB/s %5.1f MB/s %6.1fx\n", "total", total_megabytes * 1024, "", "",
+            total_megabytes / total_legacy_time, total_megabytes / total_mapped_time, total_legacy_time / total_mapped_time);
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "display.h"
+#include "stats.h"
+#include "triangle.h"
+#include "upng.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Micro-benchmark of the textured triangle rasterizer
+///////////////////////////////////////////////////////////////////////////////
+// Draws the same set of random textured triangles with every pixel kernel
+// supported by this processor and reports textured Mpixels/second of the
+// fastest pass, so other load on the machine does not skew the comparison.
+//
+// Usage: ./bench_raster [texture.png] [iterations]
+///////////////////////////////////////////////////////////////////////////////
+#define NUM_TRIANGLES 2000
+#define DEFAULT_ITERATIONS 50
+
+typedef struct {
+    screen_point_t points[3];
+    tex2_t texcoords[3];
+} bench_triangle_t;
+
+static bench_triangle_t triangles[NUM_TRIANGLES];
+
+static float random_float(unsigned* seed, float min, float max) {
+    *seed = *seed * 1103515245 + 12345;
+    return min + (max - min) * ((*seed >> 8) & 0xFFFF) / 65535.0f;
+}
+
+int main(int argc, char* argv[]) {
+    char* png_filename = argc > 1 ? argv[1] : "./assets/crab.png";
+    int iterations = argc > 2 ? atoi(argv[2]) : DEFAULT_ITERATIONS;
+
+    upng_t* texture = upng_new_from_file(png_filename);
+    if (texture == NULL || upng_decode(texture) != UPNG_EOK) {
+        fprintf(stderr, "Error loading texture %s.\n", png_filename);
+        return 1;
+    }
+    if (!init_frame_buffers()) {
+        return 1;
+    }
+
+    int width = get_window_width();
+    int height = get_window_height();
+    rect_t screen = { 0, 0, width - 1, height - 1 };
+
+    // Random triangles between 10 and 120 pixels wide, wound so they face the camera
+    unsigned seed = 1;
+    double total_area = 0;
+    for (int i = 0; i < NUM_TRIANGLES; i++) {
+        float cx = random_float(&seed, 0, width);
+        float cy = random_float(&seed, 0, height);
+        float size = random_float(&seed, 10, 120);
+        for (int v = 0; v < 3; v++) {
+            float angle = v * 2.0944f + random_float(&seed, -0.3f, 0.3f);
+            triangles[i].points[v].x = cx + cos(angle) * size;
+            triangles[i].points[v].y = cy + sin(angle) * size;
+            triangles[i].points[v].inv_w = 1 / random_float(&seed, 1, 20);
+            triangles[i].texcoords[v].u = random_float(&seed, 0, 1);
+            triangles[i].texcoords[v].v = random_float(&seed, 0, 1);
+        }
+        screen_point_t* p = triangles[i].points;
+        total_area += fabs((p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x)) / 2;
+    }
+
+    printf("%s: %d triangles, %.0f pixels per pass, %d iterations\n", png_filename, NUM_TRIANGLES, total_area, iterations);
+
+    uint32_t* reference = malloc(sizeof(uint32_t) * width * height);
+    int kernels[] = { RASTER_KERNEL_SCALAR, RASTER_KERNEL_SSE2, RASTER_KERNEL_AVX2 };
+    double baseline_rate = 0;
+
+    for (int k = 0; k < 3; k++) {
+        set_raster_kernel(kernels[k]);
+        if (get_raster_kernel() != kernels[k]) {
+            continue;
+        }
+
+        clock_t best_elapsed = 0;
+        for (int it = 0; it < iterations; it++) {
+            clear_color_buffer(0xFF000000);
+            clear_z_buffer();
+            reset_stats();
+
+            clock_t start = clock();
+            for (int i = 0; i < NUM_TRIANGLES; i++) {
+                bench_triangle_t* t = &triangles[i];
+                draw_textured_triangle(
+                    &t->points[0], t->texcoords[0].u, t->texcoords[0].v,
+                    &t->points[1], t->texcoords[1].u, t->texcoords[1].v,
+                    &t->points[2], t->texcoords[2].u, t->texcoords[2].v,
+                    texture,
+                    DEPTH_TEST_LESS,
+                    &screen
+                );
+            }
+            clock_t elapsed = clock() - start;
+            if (it == 0 || elapsed < best_elapsed) {
+                best_elapsed = elapsed;
+            }
+        }
+
+        double rate = total_area / ((double)best_elapsed / CLOCKS_PER_SEC) / 1e6;
+        if (baseline_rate == 0) {
+            baseline_rate = rate;
+        }
+
+        // Count the pixels that differ from the scalar kernel
+        int mismatches = 0;
+        if (kernels[k] == RASTER_KERNEL_SCALAR) {
+            memcpy(reference, get_color_buffer(), sizeof(uint32_t) * width * height);
+        } else {
+            for (int i = 0; i < width * height; i++) {
+                mismatches += reference[i] != get_color_buffer()[i];
+            }
+        }
+
+        printf("%-8s %10.1f textured Mpixels/s  (%.2fx)  %d pixels differ from scalar, %d candidate pixels culled by Hi-Z\n",
+            get_raster_kernel_name(), rate, rate / baseline_rate, mismatches, get_stat(STAT_PIXELS_HIZ_CULLED));
+    }
+
+    free(reference);
+    upng_free(texture);
+    return 0;
+}
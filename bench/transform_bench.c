@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "array.h"
+#include "mesh.h"
+#include "matrix.h"
+#include "transform.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Micro-benchmark of the vertex transform stage
+///////////////////////////////////////////////////////////////////////////////
+// Compares the per-vertex mat4_mul_vec4() path against every batch transform
+// kernel supported by this processor, reporting millions of vertices/second.
+//
+// Usage: ./bench_transform [file.obj] [iterations]
+///////////////////////////////////////////////////////////////////////////////
+#define DEFAULT_ITERATIONS 2000
+
+static double seconds_since(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char* argv[]) {
+    char* obj_filename = argc > 1 ? argv[1] : "./assets/earth.obj";
+    int iterations = argc > 2 ? atoi(argv[2]) : DEFAULT_ITERATIONS;
+
+    mesh_t mesh;
+    memset(&mesh, 0, sizeof(mesh));
+    load_mesh_obj_data(&mesh, obj_filename);
+
+    int num_vertices = array_length(mesh.vertices);
+    if (num_vertices == 0) {
+        fprintf(stderr, "No vertices loaded from %s.\n", obj_filename);
+        return 1;
+    }
+
+    // Same kind of matrix the renderer uses: view * translation * rotation
+    mat4_t world_matrix = mat4_mul_mat4(mat4_make_translation(0, 0, 5), mat4_make_rotation_y(0.5));
+    mat4_t view_matrix = mat4_look_at(vec3_new(1, 2, -3), vec3_new(0, 0, 5), vec3_new(0, 1, 0));
+    mat4_t world_view_matrix = mat4_mul_mat4(view_matrix, world_matrix);
+
+    vec4_t* reference = malloc(sizeof(vec4_t) * num_vertices);
+    vec4_t* out = malloc(sizeof(vec4_t) * num_vertices);
+
+    printf("%s: %d vertices, %d iterations\n", obj_filename, num_vertices, iterations);
+
+    // Current path: one scalar vertex at a time from the array of vec3_t
+    clock_t start = clock();
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < num_vertices; i++) {
+            reference[i] = mat4_mul_vec4(world_view_matrix, vec4_from_vec3(mesh.vertices[i]));
+        }
+    }
+    double elapsed = seconds_since(start);
+    double baseline_rate = (double)num_vertices * iterations / elapsed / 1e6;
+    printf("%-16s %10.1f Mvertices/s\n", "mat4_mul_vec4", baseline_rate);
+
+    int kernels[] = { TRANSFORM_KERNEL_SCALAR, TRANSFORM_KERNEL_SSE, TRANSFORM_KERNEL_AVX2 };
+    for (int k = 0; k < 3; k++) {
+        set_transform_kernel(kernels[k]);
+        if (get_transform_kernel() != kernels[k]) {
+            continue;
+        }
+
+        start = clock();
+        for (int it = 0; it < iterations; it++) {
+            transform_vertices(&world_view_matrix, mesh.vertices_x, mesh.vertices_y, mesh.vertices_z, out, num_vertices);
+        }
+        elapsed = seconds_since(start);
+        double rate = (double)num_vertices * iterations / elapsed / 1e6;
+
+        // Every kernel must match the scalar kernel bit for bit
+        bool matches = true;
+        if (kernels[k] == TRANSFORM_KERNEL_SCALAR) {
+            memcpy(reference, out, sizeof(vec4_t) * num_vertices);
+        } else {
+            matches = memcmp(reference, out, sizeof(vec4_t) * num_vertices) == 0;
+        }
+
+        printf("%-16s %10.1f Mvertices/s  (%.2fx)%s\n",
+            get_transform_kernel_name(), rate, rate / baseline_rate, matches ? "" : "  MISMATCH");
+    }
+
+    free(reference);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "triangle.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Memory benchmark of the triangle records passed between the stages
+///////////////////////////////////////////////////////////////////////////////
+// Streams the same triangles stored as the compact screen_triangle_t and as
+// the previous render record (three vec4_t points and a texture pointer)
+// through the two passes that touch every record each frame: the copy of the
+// geometry bins into the frame array, and the bounding box pass of the tile
+// binning. Reports bytes per triangle and the time of the fastest run of
+// each pass. The two layouts take turns, so other load on the machine hits
+// both alike.
+//
+// Usage: ./bench_triangles [triangles] [iterations]
+///////////////////////////////////////////////////////////////////////////////
+#define DEFAULT_TRIANGLES 1000000
+#define DEFAULT_ITERATIONS 20
+
+// Render record used before screen_triangle_t, kept here for comparison
+typedef struct {
+    vec4_t points[3];
+    tex2_t texcoords[3];
+    uint32_t color;
+    upng_t* texture;
+} legacy_triangle_t;
+
+static double seconds_since(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void keep_fastest(double* best_time, double time) {
+    if (*best_time == 0 || time < *best_time) {
+        *best_time = time;
+    }
+}
+
+// Sum of the bounding box corners of all triangles, so the pass can not be optimized away
+#define BOUNDING_BOX_PASS(triangles, num_triangles, result)                    \
+    do {                                                                       \
+        float sum = 0;                                                         \
+        for (int i = 0; i < (num_triangles); i++) {                            \
+            float x_min = MIN(MIN(triangles[i].points[0].x, triangles[i].points[1].x), triangles[i].points[2].x); \
+            float y_min = MIN(MIN(triangles[i].points[0].y, triangles[i].points[1].y), triangles[i].points[2].y); \
+            float x_max = MAX(MAX(triangles[i].points[0].x, triangles[i].points[1].x), triangles[i].points[2].x); \
+            float y_max = MAX(MAX(triangles[i].points[0].y, triangles[i].points[1].y), triangles[i].points[2].y); \
+            sum += x_min + y_min + x_max + y_max;                              \
+        }                                                                      \
+        (result) += sum;                                                       \
+    } while (0)
+
+static void report(const char* name, size_t record_size, int num_triangles, double copy_time, double bounds_time) {
+    double megabytes = (double)record_size * num_triangles / (1024 * 1024);
+    printf("%-18s %3zu bytes/triangle  %7.1f MB  copy %7.2f ms (%5.1f GB/s)  bounds %7.2f ms\n",
+        name, record_size, megabytes,
+        copy_time * 1000, 2 * megabytes / 1024 / copy_time,
+        bounds_time * 1000);
+}
+
+int main(int argc, char* argv[]) {
+    int num_triangles = argc > 1 ? atoi(argv[1]) : DEFAULT_TRIANGLES;
+    int iterations = argc > 2 ? atoi(argv[2]) : DEFAULT_ITERATIONS;
+
+    legacy_triangle_t* legacy_bin = malloc(sizeof(legacy_triangle_t) * num_triangles);
+    legacy_triangle_t* legacy_frame = malloc(sizeof(legacy_triangle_t) * num_triangles);
+    screen_triangle_t* compact_bin = malloc(sizeof(screen_triangle_t) * num_triangles);
+    screen_triangle_t* compact_frame = malloc(sizeof(screen_triangle_t) * num_triangles);
+
+    // Small triangles spread over an 800x600 screen, the same in both layouts
+    unsigned seed = 1;
+    for (int i = 0; i < num_triangles; i++) {
+        for (int v = 0; v < 3; v++) {
+            seed = seed * 1103515245 + 12345;
+            float x = (seed >> 8) % 800;
+            seed = seed * 1103515245 + 12345;
+            float y = (seed >> 8) % 600;
+            float w = 1 + v;
+            legacy_bin[i].points[v] = (vec4_t){ x, y, 0.5, w };
+            legacy_bin[i].texcoords[v] = (tex2_t){ x / 800, y / 600 };
+            compact_bin[i].points[v] = (screen_point_t){ x, y, 1 / w };
+            compact_bin[i].texcoords[v] = (tex2_t){ x / 800, y / 600 };
+        }
+        legacy_bin[i].color = 0xFFFFFFFF;
+        compact_bin[i].color = 0xFFFFFF;
+        legacy_bin[i].texture = NULL;
+        compact_bin[i].mesh_index = 0;
+    }
+
+    printf("%d triangles, %d iterations\n", num_triangles, iterations);
+
+    // Touch the destination pages once, so the page faults are not timed
+    memcpy(legacy_frame, legacy_bin, sizeof(legacy_triangle_t) * num_triangles);
+    memcpy(compact_frame, compact_bin, sizeof(screen_triangle_t) * num_triangles);
+
+    float checksum = 0;
+    double legacy_copy_time = 0, legacy_bounds_time = 0;
+    double compact_copy_time = 0, compact_bounds_time = 0;
+
+    for (int it = 0; it < iterations; it++) {
+        clock_t start = clock();
+        memcpy(legacy_frame, legacy_bin, sizeof(legacy_triangle_t) * num_triangles);
+        keep_fastest(&legacy_copy_time, seconds_since(start));
+
+        start = clock();
+        memcpy(compact_frame, compact_bin, sizeof(screen_triangle_t) * num_triangles);
+        keep_fastest(&compact_copy_time, seconds_since(start));
+
+        start = clock();
+        BOUNDING_BOX_PASS(legacy_frame, num_triangles, checksum);
+        keep_fastest(&legacy_bounds_time, seconds_since(start));
+
+        start = clock();
+        BOUNDING_BOX_PASS(compact_frame, num_triangles, checksum);
+        keep_fastest(&compact_bounds_time, seconds_since(start));
+    }
+
+    report("vec4_t + pointer", sizeof(legacy_triangle_t), num_triangles, legacy_copy_time, legacy_bounds_time);
+    report("screen_triangle_t", sizeof(screen_triangle_t), num_triangles, compact_copy_time, compact_bounds_time);
+    printf("%.0f%% fewer bytes per triangle (checksum %g)\n", 100.0 * (1 - (double)sizeof(screen_triangle_t) / sizeof(legacy_triangle_t)), checksum);
+
+    free(legacy_bin);
+    free(legacy_frame);
+    free(compact_bin);
+    free(compact_frame);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "arena.h"
+
+#define ARENA_ALIGN(size) (((size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+// The memory handed out starts right after the block header, padded to the alignment
+#define ARENA_BLOCK_DATA(block) ((char*)(block) + ARENA_ALIGN(sizeof(arena_block_t)))
+
+static arena_block_t* new_arena_block(arena_block_t* previous, size_t size) {
+    arena_block_t* block = (arena_block_t*)malloc(ARENA_ALIGN(sizeof(arena_block_t)) + size);
+    if (block == NULL) {
+        fprintf(stderr, "Error allocating %zu bytes for the arena.\n", size);
+        exit(1);
+    }
+    block->previous = previous;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Linear arena allocator for memory that only lives until the next reset
+///////////////////////////////////////////////////////////////////////////////
+// Allocations are taken from the end of the current block by bumping an
+// offset. When a block is full a new one, at least twice as large, is
+// chained in front of it, so the memory handed out earlier never moves.
+// Nothing is freed one allocation at a time, the whole arena is reset at once.
+///////////////////////////////////////////////////////////////////////////////
+void* arena_alloc(arena_t* arena, size_t size) {
+    size = ARENA_ALIGN(size);
+
+    arena_block_t* block = arena->block;
+    if (block == NULL || block->used + size > block->size) {
+        size_t block_size = block != NULL ? block->size * 2 : ARENA_MIN_BLOCK_SIZE;
+        while (block_size < size) {
+            block_size *= 2;
+        }
+        block = new_arena_block(block, block_size);
+        arena->block = block;
+    }
+
+    void* memory = ARENA_BLOCK_DATA(block) + block->used;
+    block->used += size;
+
+    arena->used += size;
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+    return memory;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Release all allocations, keeping the memory for the next frame
+///////////////////////////////////////////////////////////////////////////////
+// If the last frame needed more than one block, they are replaced by a single
+// block large enough for all of them, so after a few frames the arena settles
+// on one block and stops calling malloc.
+///////////////////////////////////////////////////////////////////////////////
+void arena_reset(arena_t* arena) {
+    arena_block_t* block = arena->block;
+    if (block != NULL && block->previous != NULL) {
+        size_t total_size = arena_get_capacity(arena);
+        arena_free(arena);
+        block = new_arena_block(NULL, total_size);
+        arena->block = block;
+    }
+    if (block != NULL) {
+        block->used = 0;
+    }
+    arena->used = 0;
+}
+
+void arena_free(arena_t* arena) {
+    arena_block_t* block = arena->block;
+    while (block != NULL) {
+        arena_block_t* previous = block->previous;
+        free(block);
+        block = previous;
+    }
+    arena->block = NULL;
+    arena->used = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Bytes currently reserved by the arena, and the most it has handed out
+///////////////////////////////////////////////////////////////////////////////
+size_t arena_get_capacity(arena_t* arena) {
+    size_t capacity = 0;
+    for (arena_block_t* block = arena->block; block != NULL; block = block->previous) {
+        capacity += block->size;
+    }
+    return capacity;
+}
+
+size_t arena_get_high_water(arena_t* arena) {
+    return arena->high_water;
+}
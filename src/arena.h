@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Every allocation starts at a multiple of this many bytes, enough for SSE loads
+#define ARENA_ALIGNMENT 16
+
+// Size of the first block, the arena grows from here as large frames need more memory
+#define ARENA_MIN_BLOCK_SIZE (64 * 1024)
+
+typedef struct arena_block {
+    struct arena_block* previous;  // Block that filled up before this one, freed on the next reset
+    size_t size;                   // Bytes of memory after the block header
+    size_t used;                   // Bytes handed out from this block
+} arena_block_t;
+
+typedef struct {
+    arena_block_t* block;  // Block that new allocations are taken from
+    size_t used;           // Bytes handed out since the last reset, across all blocks
+    size_t high_water;     // Largest number of bytes handed out between two resets
+} arena_t;
+
+void* arena_alloc(arena_t* arena, size_t size);
+void arena_reset(arena_t* arena);
+void arena_free(arena_t* arena);
+
+size_t arena_get_capacity(arena_t* arena);
+size_t arena_get_high_water(arena_t* arena);
+
+#endif
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include "array.h"
+#include "bench.h"
+
+static const char* stage_names[NUM_BENCH_STAGES] = {
+    "transform",
+    "cull",
+    "clip",
+    "project",
+    "raster",
+    "present"
+};
+
+// Time spent in each stage during the current frame
+static uint64_t stage_times[NUM_BENCH_STAGES];
+
+// Dynamic arrays with one sample per recorded frame, in milliseconds
+static double* frame_samples = NULL;
+static double* stage_samples[NUM_BENCH_STAGES];
+
+typedef struct {
+    double min;
+    double median;
+    double p99;
+    double mean;
+} bench_summary_t;
+
+///////////////////////////////////////////////////////////////////////////////
+// Timestamps from the SDL high resolution counter
+///////////////////////////////////////////////////////////////////////////////
+uint64_t get_bench_time(void) {
+    return SDL_GetPerformanceCounter();
+}
+
+double get_bench_milliseconds(uint64_t time) {
+    return (double)time * 1000 / SDL_GetPerformanceFrequency();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stage times are only added by the main thread, stages that run on the
+// thread pool add the wall time the main thread waited for them
+///////////////////////////////////////////////////////////////////////////////
+void add_bench_stage_time(int stage, uint64_t time) {
+    stage_times[stage] += time;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Record the total time of the frame and the time of each of its stages
+///////////////////////////////////////////////////////////////////////////////
+void end_bench_frame(uint64_t frame_time) {
+    double frame_milliseconds = get_bench_milliseconds(frame_time);
+    array_push(frame_samples, frame_milliseconds);
+    for (int i = 0; i < NUM_BENCH_STAGES; i++) {
+        double stage_milliseconds = get_bench_milliseconds(stage_times[i]);
+        array_push(stage_samples[i], stage_milliseconds);
+        stage_times[i] = 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Drop the samples recorded so far, after the warm-up frames
+///////////////////////////////////////////////////////////////////////////////
+void reset_bench(void) {
+    array_reset(frame_samples);
+    for (int i = 0; i < NUM_BENCH_STAGES; i++) {
+        array_reset(stage_samples[i]);
+        stage_times[i] = 0;
+    }
+}
+
+static int compare_samples(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Minimum, median, 99th percentile (nearest rank), and mean of the samples
+///////////////////////////////////////////////////////////////////////////////
+static bench_summary_t summarize_samples(double* samples) {
+    bench_summary_t summary = { 0 };
+    int num_samples = array_length(samples);
+    if (num_samples == 0) {
+        return summary;
+    }
+
+    double* sorted = malloc(sizeof(double) * num_samples);
+    memcpy(sorted, samples, sizeof(double) * num_samples);
+    qsort(sorted, num_samples, sizeof(double), compare_samples);
+
+    int p99_rank = (num_samples * 99 + 99) / 100;
+    summary.min = sorted[0];
+    summary.median = num_samples % 2 ? sorted[num_samples / 2] : (sorted[num_samples / 2 - 1] + sorted[num_samples / 2]) / 2;
+    summary.p99 = sorted[p99_rank - 1];
+    for (int i = 0; i < num_samples; i++) {
+        summary.mean += sorted[i];
+    }
+    summary.mean /= num_samples;
+
+    free(sorted);
+    return summary;
+}
+
+static void write_summary_json(FILE* file, bench_summary_t* summary) {
+    fprintf(file, "{ \"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"mean\": %.4f }",
+        summary->min, summary->median, summary->p99, summary->mean);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Write the recorded frames as JSON, all times in milliseconds:
+//
+// {
+//   "scene": "airfield", "camera_path": "orbit", "frames": 300,
+//   "frame_ms": { "min": ..., "median": ..., "p99": ..., "mean": ... },
+//   "stages_ms": { "transform": { ... }, ..., "present": { ... } },
+//   "stages_note": "..."
+// }
+//
+// Clip and project run interleaved in the geometry jobs, each job measures
+// both on its own thread and the sums are scaled by the wall time the jobs
+// took over their total thread time, so job overhead is in neither stage.
+///////////////////////////////////////////////////////////////////////////////
+bool write_bench_json(const char* filename, const char* scene, const char* camera_path) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    bench_summary_t frame_summary = summarize_samples(frame_samples);
+    fprintf(file, "{\n");
+    fprintf(file, "  \"scene\": \"%s\",\n", scene);
+    fprintf(file, "  \"camera_path\": \"%s\",\n", camera_path);
+    fprintf(file, "  \"frames\": %d,\n", array_length(frame_samples));
+    fprintf(file, "  \"frame_ms\": ");
+    write_summary_json(file, &frame_summary);
+    fprintf(file, ",\n  \"stages_ms\": {\n");
+    for (int i = 0; i < NUM_BENCH_STAGES; i++) {
+        bench_summary_t stage_summary = summarize_samples(stage_samples[i]);
+        fprintf(file, "    \"%s\": ", stage_names[i]);
+        write_summary_json(file, &stage_summary);
+        fprintf(file, i < NUM_BENCH_STAGES - 1 ? ",\n" : "\n");
+    }
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"stages_note\": \"clip and project are measured per geometry job and scaled by the job wall time over the job thread time\"\n");
+    fprintf(file, "}\n");
+
+    return fclose(file) == 0;
+}
+
+void print_bench_summary(void) {
+    bench_summary_t frame_summary = summarize_samples(frame_samples);
+    printf("%-10s %9s %9s %9s %9s\n", "ms", "min", "median", "p99", "mean");
+    printf("%-10s %9.3f %9.3f %9.3f %9.3f\n", "frame", frame_summary.min, frame_summary.median, frame_summary.p99, frame_summary.mean);
+    for (int i = 0; i < NUM_BENCH_STAGES; i++) {
+        bench_summary_t stage_summary = summarize_samples(stage_samples[i]);
+        printf("%-10s %9.3f %9.3f %9.3f %9.3f\n", stage_names[i], stage_summary.min, stage_summary.median, stage_summary.p99, stage_summary.mean);
+    }
+}
+
+void free_bench(void) {
+    array_free(frame_samples);
+    frame_samples = NULL;
+    for (int i = 0; i < NUM_BENCH_STAGES; i++) {
+        array_free(stage_samples[i]);
+        stage_samples[i] = NULL;
+    }
+}
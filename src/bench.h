@@ -0,0 +1,32 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Frames rendered at the start of the camera path before any timing is recorded
+#define BENCH_WARMUP_FRAMES 10
+
+enum bench_stage {
+    BENCH_STAGE_TRANSFORM,  // Vertex transforms, and vertex projection when clipping in homogeneous space
+    BENCH_STAGE_CULL,       // Frustum test of the meshes, meshlet and backface culling
+    BENCH_STAGE_CLIP,       // Outcodes, trivial rejection, and polygon clipping, scaled to wall time
+    BENCH_STAGE_PROJECT,    // Projection, lighting, and screen mapping of the clipped triangles, scaled to wall time
+    BENCH_STAGE_RASTER,     // Clearing, binning, and rasterizing the triangles
+    BENCH_STAGE_PRESENT,    // Handing the color buffer to SDL
+    NUM_BENCH_STAGES
+};
+
+uint64_t get_bench_time(void);
+double get_bench_milliseconds(uint64_t time);
+
+void add_bench_stage_time(int stage, uint64_t time);
+void end_bench_frame(uint64_t frame_time);
+void reset_bench(void);
+
+bool write_bench_json(const char* filename, const char* scene, const char* camera_path);
+void print_bench_summary(void);
+
+void free_bench(void);
+
+#endif
@@ -1,7 +1,22 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "array.h"
 #include "camera.h"
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
 static camera_t camera;
 
+// Path the camera follows frame by frame, and the poses of a recorded path
+static int camera_path = CAMERA_PATH_NONE;
+static camera_pose_t* recorded_poses = NULL;
+
+// Camera position when the path started, orbits and dollies are relative to it
+static vec3_t path_start_position;
+
 void init_camera(vec3_t position, vec3_t direction) {
     camera.position = position;
     camera.direction = direction;
@@ -71,3 +86,98 @@ vec3_t get_camera_lookat_target(void) {
 
     return target;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// Point the camera at a target, the inverse of get_camera_lookat_target()
+///////////////////////////////////////////////////////////////////////////////
+// The camera looks along rotation_y(yaw) * rotation_x(pitch) * (0, 0, 1),
+// which is (sin(yaw) * cos(pitch), -sin(pitch), cos(yaw) * cos(pitch)).
+///////////////////////////////////////////////////////////////////////////////
+void update_camera_lookat_target(vec3_t target) {
+    vec3_t direction = vec3_sub(target, camera.position);
+    float horizontal_length = sqrt(direction.x * direction.x + direction.z * direction.z);
+    camera.yaw = atan2(direction.x, direction.z);
+    camera.pitch = atan2(-direction.y, horizontal_length);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Select a camera path by name: "none", "orbit", "dolly", or the name of a
+// file with one "x y z yaw pitch" camera pose per line, as written by the
+// renderer with --record. Returns false if the path can not be loaded.
+///////////////////////////////////////////////////////////////////////////////
+bool set_camera_path(const char* name) {
+    array_reset(recorded_poses);
+    path_start_position = camera.position;
+
+    if (strcmp(name, "none") == 0) {
+        camera_path = CAMERA_PATH_NONE;
+        return true;
+    }
+    if (strcmp(name, "orbit") == 0) {
+        camera_path = CAMERA_PATH_ORBIT;
+        return true;
+    }
+    if (strcmp(name, "dolly") == 0) {
+        camera_path = CAMERA_PATH_DOLLY;
+        return true;
+    }
+
+    FILE* file = fopen(name, "r");
+    if (file == NULL) {
+        return false;
+    }
+    camera_pose_t pose;
+    while (fscanf(file, "%f %f %f %f %f", &pose.position.x, &pose.position.y, &pose.position.z, &pose.yaw, &pose.pitch) == 5) {
+        array_push(recorded_poses, pose);
+    }
+    fclose(file);
+
+    camera_path = CAMERA_PATH_RECORDED;
+    return array_length(recorded_poses) > 0;
+}
+
+int get_camera_path(void) {
+    return camera_path;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Move the camera to its pose for one frame of a path that lasts num_frames
+///////////////////////////////////////////////////////////////////////////////
+void update_camera_path(int frame, int num_frames, vec3_t center) {
+    float t = num_frames > 0 ? (float)frame / num_frames : 0;
+    switch (camera_path) {
+        case CAMERA_PATH_ORBIT: {
+            // Rotate the start position around the vertical axis through the center
+            float angle = 2 * M_PI * t;
+            vec3_t offset = vec3_sub(path_start_position, center);
+            camera.position = vec3_new(
+                center.x + offset.x * cos(angle) + offset.z * sin(angle),
+                path_start_position.y,
+                center.z - offset.x * sin(angle) + offset.z * cos(angle)
+            );
+            update_camera_lookat_target(center);
+            break;
+        }
+        case CAMERA_PATH_DOLLY: {
+            // Ease in and out from the start position to 90% of the way to the center
+            float amount = 0.9 * (0.5 - 0.5 * cos(2 * M_PI * t));
+            camera.position = vec3_add(path_start_position, vec3_mul(vec3_sub(center, path_start_position), amount));
+            update_camera_lookat_target(center);
+            break;
+        }
+        case CAMERA_PATH_RECORDED: {
+            camera_pose_t* pose = &recorded_poses[frame % array_length(recorded_poses)];
+            camera.position = pose->position;
+            camera.yaw = pose->yaw;
+            camera.pitch = pose->pitch;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void free_camera_path(void) {
+    array_free(recorded_poses);
+    recorded_poses = NULL;
+}
@@ -1,9 +1,23 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
+#include <stdbool.h>
 #include "vector.h"
 #include "matrix.h"
 
+enum camera_path {
+    CAMERA_PATH_NONE,     // The camera is only moved by the mouse
+    CAMERA_PATH_ORBIT,    // One full circle around the scene center, looking at it
+    CAMERA_PATH_DOLLY,    // Towards the scene center until it almost reaches it, and back
+    CAMERA_PATH_RECORDED  // Camera poses loaded from a file, one per frame
+};
+
+typedef struct {
+    vec3_t position;
+    float yaw;
+    float pitch;
+} camera_pose_t;
+
 typedef struct {
     vec3_t position;
     vec3_t direction;
@@ -28,5 +42,11 @@ void rotate_camera_yaw(float angle);
 void rotate_camera_pitch(float angle);
 
 vec3_t get_camera_lookat_target(void);
+void update_camera_lookat_target(vec3_t target);
+
+bool set_camera_path(const char* name);
+int get_camera_path(void);
+void update_camera_path(int frame, int num_frames, vec3_t center);
+void free_camera_path(void);
 
 #endif
@@ -1,8 +1,18 @@
 #include <math.h>
 #include "clipping.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CLIP_X86_KERNELS
+#endif
+
 #define NUM_PLANES 6
-plane_t frustum_planes[NUM_PLANES];
+#define NUM_CLIP_PLANES 10
+plane_t frustum_planes[NUM_CLIP_PLANES];
+
+static int clip_method = CLIP_FRUSTUM;
+static int clip_space = CLIP_SPACE_CAMERA;
+static int clip_kernel = CLIP_KERNEL_SCALAR;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Frustum planes are defined by a point and a normal vector
@@ -61,6 +71,55 @@ void init_frustum_planes(float fov_x, float fov_y, float znear, float zfar) {
 	frustum_planes[FAR_FRUSTUM_PLANE].normal.x = 0;
 	frustum_planes[FAR_FRUSTUM_PLANE].normal.y = 0;
 	frustum_planes[FAR_FRUSTUM_PLANE].normal.z = -1;
+
+	// Guard band side planes, with the tangent of the half fov scaled by GUARD_BAND_SCALE
+	float half_guard_x = atan(tan(fov_x / 2) * GUARD_BAND_SCALE);
+	float half_guard_y = atan(tan(fov_y / 2) * GUARD_BAND_SCALE);
+
+	frustum_planes[LEFT_GUARD_BAND_PLANE].point = vec3_new(0, 0, 0);
+	frustum_planes[LEFT_GUARD_BAND_PLANE].normal = vec3_new(cos(half_guard_x), 0, sin(half_guard_x));
+
+	frustum_planes[RIGHT_GUARD_BAND_PLANE].point = vec3_new(0, 0, 0);
+	frustum_planes[RIGHT_GUARD_BAND_PLANE].normal = vec3_new(-cos(half_guard_x), 0, sin(half_guard_x));
+
+	frustum_planes[TOP_GUARD_BAND_PLANE].point = vec3_new(0, 0, 0);
+	frustum_planes[TOP_GUARD_BAND_PLANE].normal = vec3_new(0, -cos(half_guard_y), sin(half_guard_y));
+
+	frustum_planes[BOTTOM_GUARD_BAND_PLANE].point = vec3_new(0, 0, 0);
+	frustum_planes[BOTTOM_GUARD_BAND_PLANE].normal = vec3_new(0, cos(half_guard_y), sin(half_guard_y));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Guard band clipping only clips against the near and far planes and the
+// much wider guard band side planes. Triangles crossing the screen edges but
+// not the guard band go straight to the rasterizer, which scissors them to
+// the screen, without the extra vertices and fan triangles of side clipping.
+///////////////////////////////////////////////////////////////////////////////
+void set_clip_method(int method) {
+    clip_method = method;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Outcode bits of the planes that triangles must be clipped against
+///////////////////////////////////////////////////////////////////////////////
+int get_clip_planes(void) {
+    if (clip_method == CLIP_GUARD_BAND) {
+        return NEAR_FAR_FRUSTUM_PLANES | ALL_GUARD_BAND_PLANES;
+    }
+    return ALL_FRUSTUM_PLANES;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The homogeneous clip space pipeline projects every vertex once and clips
+// the vec4 vertices against the canonical planes, so there is no need for the
+// trig derived camera space planes or a second projection after clipping.
+///////////////////////////////////////////////////////////////////////////////
+void set_clip_space(int space) {
+    clip_space = space;
+}
+
+bool should_clip_homogeneous(void) {
+    return clip_space == CLIP_SPACE_HOMOGENEOUS;
 }
 
 polygon_t polygon_from_triangle(vec3_t v0, vec3_t v1, vec3_t v2, tex2_t t0, tex2_t t1, tex2_t t2) {
@@ -167,10 +226,364 @@ void clip_polygon_against_plane(polygon_t* polygon, int plane) {
 }
 
 void clip_polygon(polygon_t* polygon) {
-    clip_polygon_against_plane(polygon, LEFT_FRUSTUM_PLANE);
-    clip_polygon_against_plane(polygon, RIGHT_FRUSTUM_PLANE);
-    clip_polygon_against_plane(polygon, TOP_FRUSTUM_PLANE);
-    clip_polygon_against_plane(polygon, BOTTOM_FRUSTUM_PLANE);
-    clip_polygon_against_plane(polygon, NEAR_FRUSTUM_PLANE);
-    clip_polygon_against_plane(polygon, FAR_FRUSTUM_PLANE);
+    clip_polygon_against_planes(polygon, ALL_FRUSTUM_PLANES);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Clip a polygon only against the frustum planes set in plane_mask, usually
+// the OR of the outcodes of its vertices
+///////////////////////////////////////////////////////////////////////////////
+void clip_polygon_against_planes(polygon_t* polygon, int plane_mask) {
+    for (int plane = 0; plane < NUM_CLIP_PLANES; plane++) {
+        if (plane_mask & (1 << plane)) {
+            clip_polygon_against_plane(polygon, plane);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Homogeneous clip space planes, a vertex is inside when the distance is > 0
+///////////////////////////////////////////////////////////////////////////////
+// Left plane   :  x >= -w           Left guard band   :  x >= -g*w
+// Right plane  :  x <= w            Right guard band  :  x <= g*w
+// Top plane    :  y <= w            Top guard band    :  y <= g*w
+// Bottom plane :  y >= -w           Bottom guard band :  y >= -g*w
+// Near plane   :  z >= 0
+// Far plane    :  z <= w
+///////////////////////////////////////////////////////////////////////////////
+static const vec4_t homogeneous_planes[NUM_CLIP_PLANES] = {
+    [LEFT_FRUSTUM_PLANE]      = {  1,  0,  0, 1 },
+    [RIGHT_FRUSTUM_PLANE]     = { -1,  0,  0, 1 },
+    [TOP_FRUSTUM_PLANE]       = {  0, -1,  0, 1 },
+    [BOTTOM_FRUSTUM_PLANE]    = {  0,  1,  0, 1 },
+    [NEAR_FRUSTUM_PLANE]      = {  0,  0,  1, 0 },
+    [FAR_FRUSTUM_PLANE]       = {  0,  0, -1, 1 },
+    [LEFT_GUARD_BAND_PLANE]   = {  1,  0,  0, GUARD_BAND_SCALE },
+    [RIGHT_GUARD_BAND_PLANE]  = { -1,  0,  0, GUARD_BAND_SCALE },
+    [TOP_GUARD_BAND_PLANE]    = {  0, -1,  0, GUARD_BAND_SCALE },
+    [BOTTOM_GUARD_BAND_PLANE] = {  0,  1,  0, GUARD_BAND_SCALE }
+};
+
+static float homogeneous_plane_distance(vec4_t* v, int plane) {
+    const vec4_t* p = &homogeneous_planes[plane];
+    return p->x * v->x + p->y * v->y + p->z * v->z + p->w * v->w;
+}
+
+homogeneous_polygon_t homogeneous_polygon_from_triangle(vec4_t v0, vec4_t v1, vec4_t v2, tex2_t t0, tex2_t t1, tex2_t t2) {
+    homogeneous_polygon_t polygon = {
+        .vertices = { v0, v1, v2 },
+        .texcoords = { t0, t1, t2 },
+        .num_vertices = 3
+    };
+    return polygon;
+}
+
+void triangles_from_homogeneous_polygon(homogeneous_polygon_t* polygon, triangle_t triangles[], int* num_triangles) {
+    for (int i = 0; i < polygon->num_vertices - 2; i++) {
+        triangles[i].points[0] = polygon->vertices[0];
+        triangles[i].points[1] = polygon->vertices[i + 1];
+        triangles[i].points[2] = polygon->vertices[i + 2];
+
+        triangles[i].texcoords[0] = polygon->texcoords[0];
+        triangles[i].texcoords[1] = polygon->texcoords[i + 1];
+        triangles[i].texcoords[2] = polygon->texcoords[i + 2];
+    }
+    *num_triangles = polygon->num_vertices - 2;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Clip the source polygon against one plane, writing the inside part into the
+// destination polygon so consecutive planes can ping-pong between two buffers
+///////////////////////////////////////////////////////////////////////////////
+static void clip_homogeneous_polygon_against_plane(homogeneous_polygon_t* source, homogeneous_polygon_t* destination, int plane) {
+    int num_inside_vertices = 0;
+
+    // Walk the polygon edges from the last vertex to the first one, then around
+    int previous = source->num_vertices - 1;
+    float previous_distance = homogeneous_plane_distance(&source->vertices[previous], plane);
+
+    for (int current = 0; current < source->num_vertices; current++) {
+        float current_distance = homogeneous_plane_distance(&source->vertices[current], plane);
+
+        // The edge crosses the plane, insert the intersection point with its interpolated U and V
+        if (current_distance * previous_distance < 0) {
+            float t = previous_distance / (previous_distance - current_distance);
+            vec4_t* a = &source->vertices[previous];
+            vec4_t* b = &source->vertices[current];
+            destination->vertices[num_inside_vertices] = (vec4_t) {
+                .x = float_lerp(a->x, b->x, t),
+                .y = float_lerp(a->y, b->y, t),
+                .z = float_lerp(a->z, b->z, t),
+                .w = float_lerp(a->w, b->w, t)
+            };
+            destination->texcoords[num_inside_vertices] = (tex2_t) {
+                .u = float_lerp(source->texcoords[previous].u, source->texcoords[current].u, t),
+                .v = float_lerp(source->texcoords[previous].v, source->texcoords[current].v, t)
+            };
+            num_inside_vertices++;
+        }
+
+        // The current vertex is inside the plane
+        if (current_distance > 0) {
+            destination->vertices[num_inside_vertices] = source->vertices[current];
+            destination->texcoords[num_inside_vertices] = source->texcoords[current];
+            num_inside_vertices++;
+        }
+
+        previous = current;
+        previous_distance = current_distance;
+    }
+    destination->num_vertices = num_inside_vertices;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Clip a homogeneous polygon only against the planes set in plane_mask, which
+// uses the same bits as the camera space outcodes
+///////////////////////////////////////////////////////////////////////////////
+void clip_homogeneous_polygon_against_planes(homogeneous_polygon_t* polygon, int plane_mask) {
+    homogeneous_polygon_t buffer;
+    homogeneous_polygon_t* source = polygon;
+    homogeneous_polygon_t* destination = &buffer;
+
+    for (int plane = 0; plane < NUM_CLIP_PLANES; plane++) {
+        if (plane_mask & (1 << plane)) {
+            clip_homogeneous_polygon_against_plane(source, destination, plane);
+            homogeneous_polygon_t* swap = source;
+            source = destination;
+            destination = swap;
+        }
+    }
+
+    // After an odd number of planes the result is in the local buffer
+    if (source != polygon) {
+        polygon->num_vertices = source->num_vertices;
+        for (int i = 0; i < source->num_vertices; i++) {
+            polygon->vertices[i] = source->vertices[i];
+            polygon->texcoords[i] = source->texcoords[i];
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Outcode kernels
+///////////////////////////////////////////////////////////////////////////////
+// Both clip spaces use the plane distance d = (v - point) . normal in 4D. The
+// camera space planes have a zero w in the point and normal, so d is the same
+// as in clip_polygon_against_plane, and the homogeneous planes have a zero
+// point. A vertex is outside a plane when d <= 0, and all kernels sum the
+// products in the same order so they produce identical outcodes.
+///////////////////////////////////////////////////////////////////////////////
+static void compute_plane_outcodes_scalar(vec4_t* vertices, int* indices, uint16_t* outcodes, int count, vec4_t* points, vec4_t* normals) {
+    for (int i = 0; i < count; i++) {
+        vec4_t* vertex = &vertices[indices[i]];
+        uint16_t outcode = 0;
+        for (int plane = 0; plane < NUM_CLIP_PLANES; plane++) {
+            float distance =
+                (vertex->x - points[plane].x) * normals[plane].x +
+                (vertex->y - points[plane].y) * normals[plane].y +
+                (vertex->z - points[plane].z) * normals[plane].z +
+                (vertex->w - points[plane].w) * normals[plane].w;
+            if (distance <= 0) {
+                outcode |= 1 << plane;
+            }
+        }
+        outcodes[indices[i]] = outcode;
+    }
+}
+
+#ifdef CLIP_X86_KERNELS
+
+// Load two vertices into the low and high halves of a register
+__attribute__((target("avx2")))
+static __m256 load_vertex_pair(vec4_t* vertices, int first_index, int second_index) {
+    __m256 pair = _mm256_castps128_ps256(_mm_loadu_ps(&vertices[first_index].x));
+    return _mm256_insertf128_ps(pair, _mm_loadu_ps(&vertices[second_index].x), 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 kernel, 8 vertices against one plane per instruction
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2")))
+static void compute_plane_outcodes_avx2(vec4_t* vertices, int* indices, uint16_t* outcodes, int count, vec4_t* points, vec4_t* normals) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Transpose eight vec4_t vertices into x, y, z, w lanes
+        int* index = &indices[i];
+        __m256 a0 = load_vertex_pair(vertices, index[0], index[4]); // vertex 0 | vertex 4
+        __m256 a1 = load_vertex_pair(vertices, index[1], index[5]); // vertex 1 | vertex 5
+        __m256 a2 = load_vertex_pair(vertices, index[2], index[6]); // vertex 2 | vertex 6
+        __m256 a3 = load_vertex_pair(vertices, index[3], index[7]); // vertex 3 | vertex 7
+        __m256 t0 = _mm256_unpacklo_ps(a0, a1); // x0 x1 y0 y1 | x4 x5 y4 y5
+        __m256 t1 = _mm256_unpackhi_ps(a0, a1); // z0 z1 w0 w1 | z4 z5 w4 w5
+        __m256 t2 = _mm256_unpacklo_ps(a2, a3); // x2 x3 y2 y3 | x6 x7 y6 y7
+        __m256 t3 = _mm256_unpackhi_ps(a2, a3); // z2 z3 w2 w3 | z6 z7 w6 w7
+        __m256 x = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 y = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 z = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 w = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+        // Accumulate one outcode bit per plane in each 32-bit lane
+        __m256i outcode = _mm256_setzero_si256();
+        for (int plane = 0; plane < NUM_CLIP_PLANES; plane++) {
+            __m256 dx = _mm256_mul_ps(_mm256_sub_ps(x, _mm256_set1_ps(points[plane].x)), _mm256_set1_ps(normals[plane].x));
+            __m256 dy = _mm256_mul_ps(_mm256_sub_ps(y, _mm256_set1_ps(points[plane].y)), _mm256_set1_ps(normals[plane].y));
+            __m256 dz = _mm256_mul_ps(_mm256_sub_ps(z, _mm256_set1_ps(points[plane].z)), _mm256_set1_ps(normals[plane].z));
+            __m256 dw = _mm256_mul_ps(_mm256_sub_ps(w, _mm256_set1_ps(points[plane].w)), _mm256_set1_ps(normals[plane].w));
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(dx, dy), dz), dw);
+            __m256i outside = _mm256_castps_si256(_mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LE_OQ));
+            outcode = _mm256_or_si256(outcode, _mm256_and_si256(outside, _mm256_set1_epi32(1 << plane)));
+        }
+
+        // Narrow the 32-bit lanes to the eight 16-bit outcodes
+        uint16_t packed[8];
+        _mm_storeu_si128((__m128i*)packed, _mm_packus_epi32(_mm256_castsi256_si128(outcode), _mm256_extracti128_si256(outcode, 1)));
+        for (int j = 0; j < 8; j++) {
+            outcodes[index[j]] = packed[j];
+        }
+    }
+    compute_plane_outcodes_scalar(vertices, indices + i, outcodes, count - i, points, normals);
+}
+
+#endif
+
+static void compute_plane_outcodes(vec4_t* vertices, int* indices, uint16_t* outcodes, int count, vec4_t* points, vec4_t* normals) {
+#ifdef CLIP_X86_KERNELS
+    if (clip_kernel == CLIP_KERNEL_AVX2) {
+        compute_plane_outcodes_avx2(vertices, indices, outcodes, count, points, normals);
+        return;
+    }
+#endif
+    compute_plane_outcodes_scalar(vertices, indices, outcodes, count, points, normals);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Check with CPUID if the current processor can run a given kernel
+///////////////////////////////////////////////////////////////////////////////
+static bool is_clip_kernel_supported(int kernel) {
+#ifdef CLIP_X86_KERNELS
+    __builtin_cpu_init();
+    if (kernel == CLIP_KERNEL_AVX2) {
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return kernel == CLIP_KERNEL_SCALAR;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Pick the widest kernel supported by the processor at runtime
+///////////////////////////////////////////////////////////////////////////////
+void init_clip_kernel(void) {
+    if (is_clip_kernel_supported(CLIP_KERNEL_AVX2)) {
+        clip_kernel = CLIP_KERNEL_AVX2;
+    } else {
+        clip_kernel = CLIP_KERNEL_SCALAR;
+    }
+}
+
+void set_clip_kernel(int kernel) {
+    clip_kernel = is_clip_kernel_supported(kernel) ? kernel : CLIP_KERNEL_SCALAR;
+}
+
+int get_clip_kernel(void) {
+    return clip_kernel;
+}
+
+const char* get_clip_kernel_name(void) {
+    switch (clip_kernel) {
+        case CLIP_KERNEL_AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Compute the frustum and guard band outcode of the camera space vertices at
+// the given indices, leaving the other outcodes untouched. A vertex is inside
+// a plane with the same strict "dot > 0" test used by clip_polygon.
+///////////////////////////////////////////////////////////////////////////////
+void compute_outcodes(vec4_t* vertices, int* indices, uint16_t* outcodes, int count) {
+    vec4_t points[NUM_CLIP_PLANES];
+    vec4_t normals[NUM_CLIP_PLANES];
+    for (int plane = 0; plane < NUM_CLIP_PLANES; plane++) {
+        points[plane] = vec4_from_vec3(frustum_planes[plane].point);
+        points[plane].w = 0;
+        normals[plane] = vec4_from_vec3(frustum_planes[plane].normal);
+        normals[plane].w = 0;
+    }
+    compute_plane_outcodes(vertices, indices, outcodes, count, points, normals);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Compute the frustum and guard band outcode of the projected vertices at the
+// given indices
+///////////////////////////////////////////////////////////////////////////////
+void compute_homogeneous_outcodes(vec4_t* vertices, int* indices, uint16_t* outcodes, int count) {
+    vec4_t points[NUM_CLIP_PLANES] = {{ 0 }};
+    vec4_t normals[NUM_CLIP_PLANES];
+    for (int plane = 0; plane < NUM_CLIP_PLANES; plane++) {
+        normals[plane] = homogeneous_planes[plane];
+    }
+    compute_plane_outcodes(vertices, indices, outcodes, count, points, normals);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reject a block of faces, given by their indices, against the outcodes of
+// their vertices in a single pass. The faces that are not completely outside
+// a frustum plane are written in order to surviving_faces, with the planes
+// they must be clipped against in clip_masks, and the number of surviving
+// faces is returned. The loop has no branches, every face is written and the
+// output only advances on survivors.
+///////////////////////////////////////////////////////////////////////////////
+int compact_surviving_faces(face_t* faces, int* face_indices, int num_faces, uint16_t* outcodes, int clip_planes, int* surviving_faces, uint16_t* clip_masks) {
+    int num_survivors = 0;
+    for (int i = 0; i < num_faces; i++) {
+        face_t* face = &faces[face_indices[i]];
+        uint16_t outcode_a = outcodes[face->a - 1];
+        uint16_t outcode_b = outcodes[face->b - 1];
+        uint16_t outcode_c = outcodes[face->c - 1];
+        surviving_faces[num_survivors] = face_indices[i];
+        clip_masks[num_survivors] = (outcode_a | outcode_b | outcode_c) & clip_planes;
+        num_survivors += (outcode_a & outcode_b & outcode_c & ALL_FRUSTUM_PLANES) == 0;
+    }
+    return num_survivors;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Classify a camera space bounding sphere against the six frustum planes
+///////////////////////////////////////////////////////////////////////////////
+int classify_sphere_against_frustum(vec3_t center, float radius) {
+    int result = FRUSTUM_INSIDE;
+    for (int plane = 0; plane < NUM_PLANES; plane++) {
+        float distance = vec3_dot(vec3_sub(center, frustum_planes[plane].point), frustum_planes[plane].normal);
+        if (distance < -radius) {
+            return FRUSTUM_OUTSIDE;
+        }
+        if (distance <= radius) {
+            result = FRUSTUM_INTERSECTING;
+        }
+    }
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Classify the eight camera space corners of a bounding box against the six
+// frustum planes. Corners count as inside with the same strict test used by
+// clip_polygon, so a box that is inside needs no polygon clipping at all.
+///////////////////////////////////////////////////////////////////////////////
+int classify_box_against_frustum(vec3_t corners[8]) {
+    int result = FRUSTUM_INSIDE;
+    for (int plane = 0; plane < NUM_PLANES; plane++) {
+        int num_inside_corners = 0;
+        for (int i = 0; i < 8; i++) {
+            if (vec3_dot(vec3_sub(corners[i], frustum_planes[plane].point), frustum_planes[plane].normal) > 0) {
+                num_inside_corners++;
+            }
+        }
+        if (num_inside_corners == 0) {
+            return FRUSTUM_OUTSIDE;
+        }
+        if (num_inside_corners < 8) {
+            result = FRUSTUM_INTERSECTING;
+        }
+    }
+    return result;
 }
@@ -7,13 +7,46 @@
 #define MAX_NUM_POLY_VERTICES 10
 #define MAX_NUM_POLY_TRIANGLES 10
 
+// Outcode bits, bit i is set when a vertex is not inside plane i
+#define ALL_FRUSTUM_PLANES 0x3F
+#define NEAR_FAR_FRUSTUM_PLANES ((1 << NEAR_FRUSTUM_PLANE) | (1 << FAR_FRUSTUM_PLANE))
+#define ALL_GUARD_BAND_PLANES 0x3C0
+
+// Side planes of the guard band are this many times wider and taller than the frustum
+#define GUARD_BAND_SCALE 4.0
+
 enum {
     LEFT_FRUSTUM_PLANE,
     RIGHT_FRUSTUM_PLANE,
     TOP_FRUSTUM_PLANE,
     BOTTOM_FRUSTUM_PLANE,
     NEAR_FRUSTUM_PLANE,
-    FAR_FRUSTUM_PLANE
+    FAR_FRUSTUM_PLANE,
+    LEFT_GUARD_BAND_PLANE,
+    RIGHT_GUARD_BAND_PLANE,
+    TOP_GUARD_BAND_PLANE,
+    BOTTOM_GUARD_BAND_PLANE
+};
+
+enum clip_method {
+    CLIP_FRUSTUM,
+    CLIP_GUARD_BAND
+};
+
+enum clip_space {
+    CLIP_SPACE_CAMERA,      // Clip camera space vertices against the planes from init_frustum_planes
+    CLIP_SPACE_HOMOGENEOUS  // Clip projected vertices against -w<=x,y<=w and 0<=z<=w
+};
+
+enum clip_kernel {
+    CLIP_KERNEL_SCALAR,
+    CLIP_KERNEL_AVX2
+};
+
+enum {
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECTING,
+    FRUSTUM_INSIDE
 };
 
 typedef struct {
@@ -27,9 +60,32 @@ typedef struct {
     int num_vertices;
 } polygon_t;
 
+typedef struct {
+    vec4_t vertices[MAX_NUM_POLY_VERTICES];
+    tex2_t texcoords[MAX_NUM_POLY_VERTICES];
+    int num_vertices;
+} homogeneous_polygon_t;
+
 void init_frustum_planes(float fov_x, float fov_y, float znear, float zfar);
+void init_clip_kernel(void);
+void set_clip_kernel(int kernel);
+int get_clip_kernel(void);
+const char* get_clip_kernel_name(void);
+void set_clip_method(int method);
+int get_clip_planes(void);
+void set_clip_space(int space);
+bool should_clip_homogeneous(void);
 polygon_t polygon_from_triangle(vec3_t v0, vec3_t v1, vec3_t v2, tex2_t t0, tex2_t t1, tex2_t t2);
 void triangles_from_polygon(polygon_t* polygon, triangle_t triangles[], int* num_triangles);
 void clip_polygon(polygon_t* polygon);
+void clip_polygon_against_planes(polygon_t* polygon, int plane_mask);
+void compute_outcodes(vec4_t* vertices, int* indices, uint16_t* outcodes, int count);
+homogeneous_polygon_t homogeneous_polygon_from_triangle(vec4_t v0, vec4_t v1, vec4_t v2, tex2_t t0, tex2_t t1, tex2_t t2);
+void triangles_from_homogeneous_polygon(homogeneous_polygon_t* polygon, triangle_t triangles[], int* num_triangles);
+void clip_homogeneous_polygon_against_planes(homogeneous_polygon_t* polygon, int plane_mask);
+void compute_homogeneous_outcodes(vec4_t* vertices, int* indices, uint16_t* outcodes, int count);
+int compact_surviving_faces(face_t* faces, int* face_indices, int num_faces, uint16_t* outcodes, int clip_planes, int* surviving_faces, uint16_t* clip_masks);
+int classify_sphere_against_frustum(vec3_t center, float radius);
+int classify_box_against_frustum(vec3_t corners[8]);
 
 #endif
@@ -1,12 +1,29 @@
 #include "display.h"
+#include "stats.h"
+#include "trace.h"
 
 static SDL_Window* window = NULL;
 static SDL_Renderer* renderer = NULL;
 
+// Color buffer the pixels are drawn into, either colorbuffer_memory or the locked texture memory
 static uint32_t* colorbuffer = NULL;
+static uint32_t* colorbuffer_memory = NULL;
+static int colorbuffer_pitch = 0;
+static bool colorbuffer_locked = false;
+static int present_method = PRESENT_LOCK_TEXTURE;
+
 static float* zbuffer = NULL;
 
+// Hi-Z buffer, the farthest depth stored in each block of the z-buffer
+static float* hiz_buffer = NULL;
+static int hiz_width = 0;
+static int hiz_height = 0;
+
+// Depth tests of every pixel, mapped to colors and zeroed again by draw_overdraw_heatmap
+static overdraw_t* overdraw_buffer = NULL;
+
 static SDL_Texture* colorbuffer_texture = NULL;
+static bool headless = false;
 static int window_width = 800;
 static int window_height = 600;
 
@@ -21,6 +38,46 @@ int get_window_height(void) {
     return window_height;
 }
 
+bool init_frame_buffers(void) {
+    colorbuffer_memory = (uint32_t*) malloc(sizeof(uint32_t) * window_width * window_height);
+    colorbuffer = colorbuffer_memory;
+    colorbuffer_pitch = window_width;
+    zbuffer = (float*) malloc(sizeof(float) * window_width * window_height);
+
+    hiz_width = (window_width + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE;
+    hiz_height = (window_height + HIZ_BLOCK_SIZE - 1) / HIZ_BLOCK_SIZE;
+    hiz_buffer = (float*) malloc(sizeof(float) * hiz_width * hiz_height);
+
+    overdraw_buffer = (overdraw_t*) calloc(window_width * window_height, sizeof(overdraw_t));
+
+    return colorbuffer != NULL && zbuffer != NULL && hiz_buffer != NULL && overdraw_buffer != NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Pick the memory the next frame is drawn into
+///////////////////////////////////////////////////////////////////////////////
+// With PRESENT_LOCK_TEXTURE the rasterizers write straight into the streaming
+// texture, whose rows may be padded to colorbuffer_pitch pixels, so there is
+// no full-frame copy when presenting. If the texture can not be locked, the
+// frame is drawn into colorbuffer_memory and copied with SDL_UpdateTexture.
+///////////////////////////////////////////////////////////////////////////////
+static void acquire_color_buffer(void) {
+    if (present_method == PRESENT_LOCK_TEXTURE && colorbuffer_texture != NULL) {
+        void* pixels;
+        int pitch;
+        if (SDL_LockTexture(colorbuffer_texture, NULL, &pixels, &pitch) == 0) {
+            colorbuffer = (uint32_t*)pixels;
+            colorbuffer_pitch = pitch / sizeof(uint32_t);
+            colorbuffer_locked = true;
+            return;
+        }
+        fprintf(stderr, "Error locking the color buffer texture, falling back to SDL_UpdateTexture: %s\n", SDL_GetError());
+        present_method = PRESENT_UPDATE_TEXTURE;
+    }
+    colorbuffer = colorbuffer_memory;
+    colorbuffer_pitch = window_width;
+}
+
 bool init_window(void) {
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
         fprintf(stderr, "Error initializing SDL.\n");
@@ -42,8 +99,10 @@ bool init_window(void) {
     }
 
     // Allocate the required memory in bytes to hold the color buffer and the z-buffer
-    colorbuffer = (uint32_t*) malloc(sizeof(uint32_t) * window_width * window_height);
-    zbuffer = (float*) malloc(sizeof(float) * window_width * window_height);
+    if (!init_frame_buffers()) {
+        fprintf(stderr, "Error allocating the color buffer and z-buffer.\n");
+        return false;
+    }
 
     // Creating a SDL texture that is used to display the color buffer
     colorbuffer_texture = SDL_CreateTexture(
@@ -54,12 +113,53 @@ bool init_window(void) {
         window_height
     );
 
+    // Pick the color buffer of the first frame
+    acquire_color_buffer();
+
     // Locks mouse and hides cursor
     SDL_SetRelativeMouseMode(1);
     
     return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Initialize an offscreen display with no window, renderer, or texture
+///////////////////////////////////////////////////////////////////////////////
+// Only the color buffer and the z-buffer are allocated, so the renderer runs
+// on machines without a display or a GPU, and frames are not held back by
+// vsync. Frames are presented nowhere, but can be saved with
+// save_color_buffer().
+///////////////////////////////////////////////////////////////////////////////
+bool init_headless(void) {
+    if (SDL_Init(0) != 0) {
+        fprintf(stderr, "Error initializing SDL.\n");
+        return false;
+    }
+
+    if (!init_frame_buffers()) {
+        fprintf(stderr, "Error allocating the color buffer and z-buffer.\n");
+        return false;
+    }
+
+    headless = true;
+    return true;
+}
+
+bool is_headless(void) {
+    return headless;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The present method changes at the start of the next frame
+///////////////////////////////////////////////////////////////////////////////
+void set_present_method(int method) {
+    present_method = method;
+}
+
+int get_present_method(void) {
+    return present_method;
+}
+
 void set_render_method(int method) {
     render_method = method;
 }
@@ -93,7 +193,21 @@ bool should_render_filled_triangle(void) {
 bool should_render_textured_triangle(void) {
     return (
         render_method == RENDER_TEXTURED ||
-        render_method == RENDER_TEXTURED_WIRE
+        render_method == RENDER_TEXTURED_WIRE ||
+        render_method == RENDER_TEXTURED_PREPASS ||
+        render_method == RENDER_OVERDRAW
+    );
+}
+
+bool should_render_depth_prepass(void) {
+    return (
+        render_method == RENDER_TEXTURED_PREPASS
+    );
+}
+
+bool should_render_overdraw(void) {
+    return (
+        render_method == RENDER_OVERDRAW
     );
 }
 
@@ -104,7 +218,7 @@ bool should_cull_backface(void) {
 void draw_grid(void) {
     for (int y = 0; y < window_height; y += 10) {
         for (int x = 0; x < window_width; x += 10) {
-            colorbuffer[(window_width * y) + x] = 0xFF444444;
+            colorbuffer[(colorbuffer_pitch * y) + x] = 0xFF444444;
         }
     }
 }
@@ -113,7 +227,7 @@ inline void draw_pixel(int x, int y, uint32_t color) {
     if (x < 0 || x >= window_width || y < 0 || y >= window_height) {
         return;
     }
-    colorbuffer[(window_width * y) + x] = color;
+    colorbuffer[(colorbuffer_pitch * y) + x] = color;
 }
 
 inline void draw_line(int x0, int y0, int x1, int y1, uint32_t color) {
@@ -146,19 +260,68 @@ void draw_rect(int x, int y, int width, int height, uint32_t color) {
 }
 
 void render_color_buffer(void) {
-    SDL_UpdateTexture(
-        colorbuffer_texture,
-        NULL,
-        colorbuffer,
-        (int)(window_width * sizeof(uint32_t))
-    );
+    if (is_headless()) {
+        return;
+    }
+    TRACE_BEGIN(render_color_buffer_zone);
+    if (colorbuffer_locked) {
+        SDL_UnlockTexture(colorbuffer_texture);
+        colorbuffer_locked = false;
+    } else {
+        SDL_UpdateTexture(
+            colorbuffer_texture,
+            NULL,
+            colorbuffer,
+            (int)(colorbuffer_pitch * sizeof(uint32_t))
+        );
+    }
     SDL_RenderCopy(renderer, colorbuffer_texture, NULL, NULL);
+
+    // Presenting waits for the vertical blank, so long zones here are vsync stalls
+    TRACE_BEGIN(present_zone);
     SDL_RenderPresent(renderer);
+    TRACE_END(present_zone, "SDL_RenderPresent", TRACE_NO_ARG);
+
+    // Pick the color buffer of the next frame
+    acquire_color_buffer();
+    TRACE_END(render_color_buffer_zone, "render_color_buffer", TRACE_NO_ARG);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Save the color buffer as a binary PPM image, returning false on error
+///////////////////////////////////////////////////////////////////////////////
+bool save_color_buffer(const char* filename) {
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", window_width, window_height);
+
+    // Pixels are stored as RGBA bytes, keep the first three of each one
+    uint8_t* row = (uint8_t*)malloc(window_width * 3);
+    if (row == NULL) {
+        fclose(file);
+        return false;
+    }
+    for (int y = 0; y < window_height; y++) {
+        uint8_t* pixels = (uint8_t*)&colorbuffer[colorbuffer_pitch * y];
+        for (int x = 0; x < window_width; x++) {
+            row[x * 3 + 0] = pixels[x * 4 + 0];
+            row[x * 3 + 1] = pixels[x * 4 + 1];
+            row[x * 3 + 2] = pixels[x * 4 + 2];
+        }
+        fwrite(row, 3, window_width, file);
+    }
+    free(row);
+    return fclose(file) == 0;
 }
 
 void clear_color_buffer(uint32_t color) {
-    for (int i = 0; i < window_width * window_height; i++) {
-        colorbuffer[i] = color;
+    for (int y = 0; y < window_height; y++) {
+        uint32_t* color_row = &colorbuffer[colorbuffer_pitch * y];
+        for (int x = 0; x < window_width; x++) {
+            color_row[x] = color;
+        }
     }
 }
 
@@ -166,6 +329,22 @@ void clear_z_buffer(void) {
     for (int i = 0; i < window_width * window_height; i++) {
         zbuffer[i] = 1.0;
     }
+    for (int i = 0; i < hiz_width * hiz_height; i++) {
+        hiz_buffer[i] = 1.0;
+    }
+}
+
+uint32_t* get_color_buffer(void) {
+    return colorbuffer;
+}
+
+// Number of pixels from the start of one color buffer row to the next, at least the window width
+int get_color_buffer_pitch(void) {
+    return colorbuffer_pitch;
+}
+
+float* get_z_buffer(void) {
+    return zbuffer;
 }
 
 float get_zbuffer_at(int x, int y) {
@@ -182,10 +361,83 @@ void update_zbuffer_at(int x, int y, float value) {
     zbuffer[(window_width * y) + x] = value;
 }
 
+float* get_hiz_buffer(void) {
+    return hiz_buffer;
+}
+
+int get_hiz_width(void) {
+    return hiz_width;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Recompute the farthest depth of one Hi-Z block after pixels were written
+///////////////////////////////////////////////////////////////////////////////
+void update_hiz_block(int block_x, int block_y) {
+    int x_start = block_x * HIZ_BLOCK_SIZE;
+    int y_start = block_y * HIZ_BLOCK_SIZE;
+    int x_end = x_start + HIZ_BLOCK_SIZE < window_width ? x_start + HIZ_BLOCK_SIZE : window_width;
+    int y_end = y_start + HIZ_BLOCK_SIZE < window_height ? y_start + HIZ_BLOCK_SIZE : window_height;
+
+    float max_depth = 0.0;
+    for (int y = y_start; y < y_end; y++) {
+        float* depth_row = &zbuffer[window_width * y];
+        for (int x = x_start; x < x_end; x++) {
+            max_depth = depth_row[x] > max_depth ? depth_row[x] : max_depth;
+        }
+    }
+    hiz_buffer[(hiz_width * block_y) + block_x] = max_depth;
+}
+
+overdraw_t* get_overdraw_buffer(void) {
+    return overdraw_buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Colors of the overdraw heatmap by the number of depth tests of a pixel:
+// black, blue, cyan, green, yellow, orange, red, and white for 7 or more
+///////////////////////////////////////////////////////////////////////////////
+static const uint32_t overdraw_colors[] = {
+    0xFF000000, 0xFFFF0000, 0xFFFFFF00, 0xFF00FF00, 0xFF00FFFF, 0xFF0080FF, 0xFF0000FF, 0xFFFFFFFF
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Replace the pixels of a rectangle by the heatmap color of their depth
+// tests, and zero the counts for the next frame. Each tile maps its own
+// pixels, so the tiles can do it in parallel.
+///////////////////////////////////////////////////////////////////////////////
+void draw_overdraw_heatmap(rect_t* rect) {
+    int max_color = sizeof(overdraw_colors) / sizeof(overdraw_colors[0]) - 1;
+    int num_covered_pixels = 0;
+    int num_overdrawn_pixels = 0;
+    for (int y = rect->y_min; y <= rect->y_max; y++) {
+        uint32_t* color_row = &colorbuffer[colorbuffer_pitch * y];
+        overdraw_t* overdraw_row = &overdraw_buffer[window_width * y];
+        for (int x = rect->x_min; x <= rect->x_max; x++) {
+            int num_tests = overdraw_row[x].num_tests;
+            color_row[x] = overdraw_colors[num_tests < max_color ? num_tests : max_color];
+            STAT_COUNT(num_covered_pixels, num_tests > 0);
+            STAT_COUNT(num_overdrawn_pixels, overdraw_row[x].num_passes > 1);
+            overdraw_row[x].num_tests = 0;
+            overdraw_row[x].num_passes = 0;
+        }
+    }
+    stats_t* stats = get_current_thread_stats();
+    STAT_ADD(stats, STAT_PIXELS_COVERED, num_covered_pixels);
+    STAT_ADD(stats, STAT_PIXELS_OVERDRAWN, num_overdrawn_pixels);
+}
+
 void destroy_window(void) {
-    free(colorbuffer);
+    if (colorbuffer_locked) {
+        SDL_UnlockTexture(colorbuffer_texture);
+    }
+    free(colorbuffer_memory);
     free(zbuffer);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    free(hiz_buffer);
+    free(overdraw_buffer);
+    if (!is_headless()) {
+        SDL_DestroyTexture(colorbuffer_texture);
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+    }
     SDL_Quit();
 }
@@ -8,30 +8,61 @@
 #define FPS 120
 #define FRAME_TARGET_TIME (1000 / FPS)
 
+// Width and height in pixels of the z-buffer blocks tracked by the Hi-Z buffer
+#define HIZ_BLOCK_SIZE 8
+
+typedef struct {
+    int x_min;
+    int y_min;
+    int x_max;
+    int y_max;
+} rect_t;
+
 enum cull_method {
     CULL_NONE,
     CULL_BACKFACE
 };
 
+enum present_method {
+    PRESENT_UPDATE_TEXTURE,  // Draw into a separate color buffer, copied into the texture by SDL_UpdateTexture
+    PRESENT_LOCK_TEXTURE     // Draw straight into the texture memory returned by SDL_LockTexture
+};
+
 enum render_method {
     RENDER_WIRE,
     RENDER_WIRE_VERTEX,
     RENDER_FILL_TRIANGLE,
     RENDER_FILL_TRIANGLE_WIRE,
     RENDER_TEXTURED,
-    RENDER_TEXTURED_WIRE
+    RENDER_TEXTURED_WIRE,
+    RENDER_TEXTURED_PREPASS,
+    RENDER_OVERDRAW
 };
 
+// Depth tests run at one pixel in the current frame, counted by RENDER_OVERDRAW
+typedef struct {
+    uint16_t num_tests;
+    uint16_t num_passes;
+} overdraw_t;
+
+bool init_frame_buffers(void);
 bool init_window(void);
+bool init_headless(void);
+bool is_headless(void);
 int get_window_width(void);
 int get_window_height(void);
 
+void set_present_method(int method);
+int get_present_method(void);
+
 void set_render_method(int method);
 void set_cull_method(int method);
 bool should_render_wire(void);
 bool should_render_wire_vertex(void);
 bool should_render_textured_triangle(void);
 bool should_render_filled_triangle(void);
+bool should_render_depth_prepass(void);
+bool should_render_overdraw(void);
 bool should_cull_backface(void);
 
 void draw_grid(void);
@@ -42,10 +73,22 @@ void draw_rect(int x, int y, int width, int height, uint32_t color);
 void clear_color_buffer(uint32_t color);
 void clear_z_buffer(void);
 void render_color_buffer(void);
+bool save_color_buffer(const char* filename);
+
+uint32_t* get_color_buffer(void);
+int get_color_buffer_pitch(void);
+float* get_z_buffer(void);
 
 float get_zbuffer_at(int x, int y);
 void update_zbuffer_at(int x, int y, float value);
 
+float* get_hiz_buffer(void);
+int get_hiz_width(void);
+void update_hiz_block(int block_x, int block_y);
+
+overdraw_t* get_overdraw_buffer(void);
+void draw_overdraw_heatmap(rect_t* rect);
+
 void destroy_window(void);
 
 #endif
@@ -1,9 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <stdbool.h>
 #include <SDL.h>
 #include "upng.h"
 #include "array.h"
+#include "arena.h"
 #include "display.h"
 #include "triangle.h"
 #include "clipping.h"
@@ -13,6 +16,13 @@
 #include "camera.h"
 #include "texture.h"
 #include "mesh.h"
+#include "transform.h"
+#include "threadpool.h"
+#include "tiles.h"
+#include "scene.h"
+#include "bench.h"
+#include "stats.h"
+#include "trace.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Global variables for execution status and game loop
@@ -24,12 +34,50 @@ float delta_time = 0;
 uint32_t fps, last_fps;
 
 ///////////////////////////////////////////////////////////////////////////////
-// Array to store triangles that should be rendered each frame
+// Command line options
 ///////////////////////////////////////////////////////////////////////////////
-#define MAX_TRIANGLES 10000
-triangle_t triangles_to_render[MAX_TRIANGLES];
+#define DEFAULT_HEADLESS_FRAMES 300
+#define DEFAULT_CAMERA_PATH_FRAMES 600
+
+bool headless = false;              // Render offscreen, without a window or vsync
+int max_frames = 0;                 // Stop after this many frames, 0 to run until the window is closed
+const char* dump_prefix = NULL;     // Save each headless frame as <dump_prefix>_<frame>.ppm
+const char* scene_name = "f22";     // Scene loaded at startup
+const char* camera_path = "none";   // Path followed by the camera, see set_camera_path()
+const char* bench_filename = NULL;  // Write the frame and stage timings to this JSON file
+const char* record_filename = NULL; // Save the camera pose of every frame to this file
+const char* trace_filename = NULL;  // Write the zones of the last frames as a Chrome trace on exit
+
+///////////////////////////////////////////////////////////////////////////////
+// Array to store triangles that should be rendered each frame, allocated from
+// the frame arena so it grows with the scene and is reset instead of freed
+///////////////////////////////////////////////////////////////////////////////
+arena_t frame_arena = { 0 };
+screen_triangle_t* triangles_to_render = NULL;
 int triangles_to_render_count = 0;
 
+///////////////////////////////////////////////////////////////////////////////
+// Geometry jobs processing contiguous ranges of mesh faces on the thread pool.
+// Each job writes into its own triangle bin, and the bins are merged in job
+// order so the output is identical to processing the faces sequentially.
+///////////////////////////////////////////////////////////////////////////////
+#define FACES_PER_JOB 256
+
+typedef struct {
+    mesh_t* mesh;
+    int mesh_index;           // Index of the mesh in the scene, saved in its triangles to find the texture
+    mat4_t normal_matrix;     // Inverse transpose of the world view matrix, for the model space face normals
+    int first_face;           // Range of the mesh front faces processed by this job
+    int last_face;
+    bool needs_clipping;      // False when the whole mesh is inside the view frustum
+    uint64_t clip_time;       // Time the job spent rejecting and clipping faces
+    uint64_t project_time;    // Time the job spent lighting, projecting, and binning the clipped triangles
+    uint64_t total_time;      // Time the job took from start to end
+} geometry_job_t;
+
+geometry_job_t* geometry_jobs = NULL;
+screen_triangle_t** geometry_bins = NULL;
+
 ///////////////////////////////////////////////////////////////////////////////
 // Declaration of our global transformation matrices
 ///////////////////////////////////////////////////////////////////////////////
@@ -40,11 +88,22 @@ mat4_t view_matrix;
 ///////////////////////////////////////////////////////////////////////////////
 // Setup function to initialize variables and game objects
 ///////////////////////////////////////////////////////////////////////////////
-void setup(void) {
+bool setup(void) {
     // Initialize render mode and triangle culling method
     set_render_method(RENDER_TEXTURED);
     set_cull_method(CULL_BACKFACE);
 
+    // Pick the widest vertex transform, outcode, and pixel kernels supported by this processor
+    init_transform_kernel();
+    init_clip_kernel();
+    init_raster_kernel();
+
+    // Start one worker thread per logical CPU core
+    init_thread_pool(0);
+
+    // Split the screen into tiles that are rasterized independently
+    init_tiles(get_window_width(), get_window_height());
+
     // Initialize the scene light direction
     init_light(vec3_new(0, 0, 1));
 
@@ -60,20 +119,25 @@ void setup(void) {
     // Initialize frustum planes with a point and a normal
     init_frustum_planes(fov_x, fov_y, znear, zfar);
 
-    // Loads mesh entities
-    load_mesh("./assets/f22.obj", "./assets/f22.png", vec3_new(1, 1, 1), vec3_new(0, 0, +5), vec3_new(0, 0, 0));
+    // Loads the mesh entities of the scene, see scene.c for the available scenes
+    if (!load_scene(scene_name)) {
+        fprintf(stderr, "Error loading scene %s.\n", scene_name);
+        return false;
+    }
 
-    // Loads mesh entities
-    // load_mesh("./assets/runway.obj", "./assets/runway.png", vec3_new(1, 1, 1), vec3_new(0, -1.5, +23), vec3_new(0, 0, 0));
-    // load_mesh("./assets/f22.obj", "./assets/f22.png", vec3_new(1, 1, 1), vec3_new(0, -1.3, +5), vec3_new(0, -M_PI/2, 0));
-    // load_mesh("./assets/efa.obj", "./assets/efa.png", vec3_new(1, 1, 1), vec3_new(-2, -1.3, +9), vec3_new(0, -M_PI/2, 0));
-    // load_mesh("./assets/f117.obj", "./assets/f117.png", vec3_new(1, 1, 1), vec3_new(+2, -1.3, +9), vec3_new(0, -M_PI/2, 0));
+    // Start the camera path from the initial camera position
+    if (!set_camera_path(camera_path)) {
+        fprintf(stderr, "Error loading camera path %s.\n", camera_path);
+        return false;
+    }
+    return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Poll system events and handle keyboard input
 ///////////////////////////////////////////////////////////////////////////////
 void process_input(void) {
+    TRACE_BEGIN(input_zone);
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         switch (event.type) {
@@ -122,23 +186,169 @@ void process_input(void) {
                 if (event.key.keysym.sym == SDLK_6) {
                     set_render_method(RENDER_TEXTURED_WIRE);
                 }
+                if (event.key.keysym.sym == SDLK_7) {
+                    set_render_method(RENDER_TEXTURED_PREPASS);
+                }
+                if (event.key.keysym.sym == SDLK_8) {
+                    set_render_method(RENDER_OVERDRAW);
+                }
                 if (event.key.keysym.sym == SDLK_c) {
                     set_cull_method(CULL_BACKFACE);
                 }
                 if (event.key.keysym.sym == SDLK_x) {
                     set_cull_method(CULL_NONE);
                 }
+                if (event.key.keysym.sym == SDLK_g) {
+                    set_clip_method(CLIP_GUARD_BAND);
+                }
+                if (event.key.keysym.sym == SDLK_f) {
+                    set_clip_method(CLIP_FRUSTUM);
+                }
+                if (event.key.keysym.sym == SDLK_h) {
+                    set_clip_space(CLIP_SPACE_HOMOGENEOUS);
+                }
+                if (event.key.keysym.sym == SDLK_v) {
+                    set_clip_space(CLIP_SPACE_CAMERA);
+                }
+                if (event.key.keysym.sym == SDLK_m) {
+                    set_meshlet_culling(true);
+                }
+                if (event.key.keysym.sym == SDLK_n) {
+                    set_meshlet_culling(false);
+                }
+                if (event.key.keysym.sym == SDLK_l) {
+                    set_present_method(PRESENT_LOCK_TEXTURE);
+                }
+                if (event.key.keysym.sym == SDLK_u) {
+                    set_present_method(PRESENT_UPDATE_TEXTURE);
+                }
+                if (event.key.keysym.sym == SDLK_t) {
+                    if (write_trace_json(TRACE_DEFAULT_FILENAME)) {
+                        printf("Trace saved to %s\n", TRACE_DEFAULT_FILENAME);
+                    } else {
+                        fprintf(stderr, "Error writing %s.\n", TRACE_DEFAULT_FILENAME);
+                    }
+                }
                 break;
             }
         }
     }
+    TRACE_END(input_zone, "process_input", TRACE_NO_ARG);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Classify the bounds of a mesh against the view frustum in camera space.
+// The bounding sphere is tested first since it is cheaper, and the tighter
+// bounding box is only tested when the sphere intersects a frustum plane.
+///////////////////////////////////////////////////////////////////////////////
+int classify_mesh_against_frustum(mesh_t* mesh, mat4_t* world_view_matrix) {
+    // The world and view matrices only scale, rotate, and translate, so the radius grows with the largest scale
+    vec4_t center = mat4_mul_vec4(*world_view_matrix, vec4_from_vec3(mesh->bounds_center));
+    float max_scale = fmax(fmax(fabs(mesh->scale.x), fabs(mesh->scale.y)), fabs(mesh->scale.z));
+    int result = classify_sphere_against_frustum(vec3_from_vec4(center), mesh->bounds_radius * max_scale);
+    if (result != FRUSTUM_INTERSECTING) {
+        return result;
+    }
+
+    vec3_t corners[8];
+    for (int i = 0; i < 8; i++) {
+        vec3_t corner = {
+            i & 1 ? mesh->bounds_max.x : mesh->bounds_min.x,
+            i & 2 ? mesh->bounds_max.y : mesh->bounds_min.y,
+            i & 4 ? mesh->bounds_max.z : mesh->bounds_min.z
+        };
+        corners[i] = vec3_from_vec4(mat4_mul_vec4(*world_view_matrix, vec4_from_vec3(corner)));
+    }
+    return classify_box_against_frustum(corners);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Backface cull one face in model space, keeping it and marking its vertices
+// if it is facing the camera
+///////////////////////////////////////////////////////////////////////////////
+void cull_mesh_face(mesh_t* mesh, int face_index, vec3_t camera_position, bool flip_winding) {
+    if (should_cull_backface()) {
+        // Signed distance of the camera to the face plane, negative when the face is looking away from the camera
+        vec4_t plane = mesh->face_planes[face_index];
+        float distance = plane.x * camera_position.x + plane.y * camera_position.y + plane.z * camera_position.z + plane.w;
+        if (flip_winding ? distance > 0 : distance < 0) {
+            return;
+        }
+    }
+    face_t face = mesh->faces[face_index];
+    array_push(mesh->front_faces, face_index);
+    mesh->vertex_marks[face.a - 1] = 1;
+    mesh->vertex_marks[face.b - 1] = 1;
+    mesh->vertex_marks[face.c - 1] = 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Backface cull the mesh faces in model space against the camera position,
+// keeping the front faces and the sorted list of the vertices they reference
+// so culled faces never go through the vertex transform. A mirroring world
+// matrix flips the winding of the transformed faces, so the test flips too.
+// With meshlet culling, whole meshlets facing away from the camera or outside
+// the frustum are rejected before their faces are visited.
+///////////////////////////////////////////////////////////////////////////////
+void cull_mesh_faces(mesh_t* mesh, mat4_t* world_view_matrix, vec3_t camera_position, bool flip_winding, bool needs_frustum_test) {
+    int num_faces = array_length(mesh->faces);
+    int num_vertices = array_length(mesh->vertices);
+    int num_frustum_culled_faces = 0;
+    stats_t* stats = get_thread_stats(0);
+    array_reset(mesh->front_faces);
+    array_reset(mesh->referenced_vertices);
+    memset(mesh->vertex_marks, 0, num_vertices);
+
+    if (should_cull_meshlets()) {
+        float max_scale = fmax(fmax(fabs(mesh->scale.x), fabs(mesh->scale.y)), fabs(mesh->scale.z));
+        for (int i = 0; i < array_length(mesh->meshlets); i++) {
+            meshlet_t* meshlet = &mesh->meshlets[i];
+            STAT_ADD(stats, STAT_MESHLETS_VISITED, 1);
+
+            // All the meshlet faces are looking away from the camera
+            if (should_cull_backface() && is_meshlet_backfacing(meshlet, camera_position, flip_winding)) {
+                STAT_ADD(stats, STAT_MESHLETS_CONE_CULLED, 1);
+                continue;
+            }
+
+            // The meshlet bounding sphere is outside the view frustum
+            if (needs_frustum_test) {
+                vec4_t center = mat4_mul_vec4(*world_view_matrix, vec4_from_vec3(meshlet->center));
+                if (classify_sphere_against_frustum(vec3_from_vec4(center), meshlet->radius * max_scale) == FRUSTUM_OUTSIDE) {
+                    STAT_ADD(stats, STAT_MESHLETS_FRUSTUM_CULLED, 1);
+                    STAT_COUNT(num_frustum_culled_faces, meshlet->num_faces);
+                    continue;
+                }
+            }
+
+            for (int j = 0; j < meshlet->num_faces; j++) {
+                cull_mesh_face(mesh, mesh->meshlet_faces[meshlet->first_face + j], camera_position, flip_winding);
+            }
+        }
+    } else {
+        for (int i = 0; i < num_faces; i++) {
+            cull_mesh_face(mesh, i, camera_position, flip_winding);
+        }
+    }
+
+    // Faces that are not front faces were culled in model space, except the ones in meshlets outside the frustum
+    STAT_ADD(stats, STAT_FACES_VISITED, num_faces);
+    STAT_ADD(stats, STAT_FACES_BACKFACE_CULLED, num_faces - array_length(mesh->front_faces) - num_frustum_culled_faces);
+    STAT_ADD(stats, STAT_FACES_FRUSTUM_REJECTED, num_frustum_culled_faces);
+
+    // Collect the marked vertices in index order, so the transform walks the vertex arrays forward
+    for (int i = 0; i < num_vertices; i++) {
+        if (mesh->vertex_marks[i]) {
+            array_push(mesh->referenced_vertices, i);
+        }
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Process the graphics pipeline stages for all the mesh triangles
 ///////////////////////////////////////////////////////////////////////////////
 // +-------------+
-// | Model space |  <-- original mesh vertices
+// | Model space |  <-- original mesh vertices, meshlets and faces culled against the camera
 // +-------------+
 // |   +-------------+
 // `-> | World space |  <-- multiply by world matrix
@@ -158,8 +368,14 @@ void process_input(void) {
 //                        |    +--------------+
 //                        `--> | Screen space |  <-- ready to render
 //                             +--------------+
+//
+// With CLIP_SPACE_HOMOGENEOUS the projection is done once per vertex before
+// clipping, and the projected vertices are clipped against -w<=x,y<=w, 0<=z<=w
 ///////////////////////////////////////////////////////////////////////////////
-void process_graphics_pipeline_stages(mesh_t* mesh) {
+void process_graphics_pipeline_stages(int mesh_index) {
+    mesh_t* mesh = get_mesh(mesh_index);
+    stats_t* stats = get_thread_stats(0);
+
     // Create scale, rotation, and translation matrices that will be used to multiply the mesh vertices
     mat4_t scale_matrix = mat4_make_scale(mesh->scale.x, mesh->scale.y, mesh->scale.z);
     mat4_t translation_matrix = mat4_make_translation(mesh->translation.x, mesh->translation.y, mesh->translation.z);
@@ -172,79 +388,190 @@ void process_graphics_pipeline_stages(mesh_t* mesh) {
     vec3_t up_direction = vec3_new(0, 1, 0);
     view_matrix = mat4_look_at(get_camera_position(), target, up_direction);
 
-    // Loop all triangle faces of our mesh
-    int num_faces = array_length(mesh->faces);
-    for (int face_index = 0; face_index < num_faces; face_index++) {
-        face_t mesh_face = mesh->faces[face_index];
-
-        vec3_t face_vertices[3];
-        face_vertices[0] = mesh->vertices[mesh_face.a - 1];
-        face_vertices[1] = mesh->vertices[mesh_face.b - 1];
-        face_vertices[2] = mesh->vertices[mesh_face.c - 1];
-
-        vec4_t transformed_vertices[3];
-
-        // Loop all three vertices of this current face and apply transformations
-        for (int v = 0; v < 3; v++) {
-            vec4_t transformed_vertex = vec4_from_vec3(face_vertices[v]);
-
-            // Create a World Matrix combining scale, rotation, and translation matrices
-            world_matrix = mat4_identity();
-
-            // Order matters: First scale, then rotate, then translate. [T]*[R]*[S]*v
-            world_matrix = mat4_mul_mat4(scale_matrix, world_matrix);
-            world_matrix = mat4_mul_mat4(rotation_matrix_z, world_matrix);
-            world_matrix = mat4_mul_mat4(rotation_matrix_y, world_matrix);
-            world_matrix = mat4_mul_mat4(rotation_matrix_x, world_matrix);
-            world_matrix = mat4_mul_mat4(translation_matrix, world_matrix);
+    // Create a World Matrix combining scale, rotation, and translation matrices
+    world_matrix = mat4_identity();
+
+    // Order matters: First scale, then rotate, then translate. [T]*[R]*[S]*v
+    world_matrix = mat4_mul_mat4(scale_matrix, world_matrix);
+    world_matrix = mat4_mul_mat4(rotation_matrix_z, world_matrix);
+    world_matrix = mat4_mul_mat4(rotation_matrix_y, world_matrix);
+    world_matrix = mat4_mul_mat4(rotation_matrix_x, world_matrix);
+    world_matrix = mat4_mul_mat4(translation_matrix, world_matrix);
+
+    // Combine the world and view matrices so every vertex needs a single multiplication
+    mat4_t world_view_matrix = mat4_mul_mat4(view_matrix, world_matrix);
+
+    // Skip the whole mesh if its bounds are outside the view frustum, and skip clipping if they are inside
+    uint64_t cull_start_time = get_bench_time();
+    int frustum_test = classify_mesh_against_frustum(mesh, &world_view_matrix);
+    if (frustum_test == FRUSTUM_OUTSIDE) {
+        STAT_ADD(stats, STAT_MESHES_OUTSIDE, 1);
+        add_bench_stage_time(BENCH_STAGE_CULL, get_bench_time() - cull_start_time);
+        return;
+    }
+    STAT_ADD(stats, frustum_test == FRUSTUM_INSIDE ? STAT_MESHES_INSIDE : STAT_MESHES_INTERSECTING, 1);
+
+    // Bring the camera, which is the origin of camera space, into model space and cull the back faces there
+    mat4_t inverse_world_view_matrix = mat4_inverse(world_view_matrix);
+    vec3_t model_camera_position = vec3_from_vec4(mat4_mul_vec4(inverse_world_view_matrix, (vec4_t){ 0, 0, 0, 1 }));
+    bool flip_winding = mesh->scale.x * mesh->scale.y * mesh->scale.z < 0;
+    cull_mesh_faces(mesh, &world_view_matrix, model_camera_position, flip_winding, frustum_test != FRUSTUM_INSIDE);
+    uint64_t transform_start_time = get_bench_time();
+    add_bench_stage_time(BENCH_STAGE_CULL, transform_start_time - cull_start_time);
+
+    // Transform every unique vertex referenced by a front face once into the post-transform vertex buffer
+    int num_referenced_vertices = array_length(mesh->referenced_vertices);
+    transform_vertices_indexed(
+        &world_view_matrix,
+        mesh->vertices_x,
+        mesh->vertices_y,
+        mesh->vertices_z,
+        mesh->referenced_vertices,
+        mesh->transformed_vertices,
+        num_referenced_vertices
+    );
+    STAT_ADD(stats, STAT_VERTICES_TRANSFORMED, num_referenced_vertices);
+    STAT_ADD(stats, STAT_VERTICES_TOTAL, array_length(mesh->vertices));
+
+    // Project every referenced vertex once when clipping happens in homogeneous clip space
+    if (should_clip_homogeneous()) {
+        for (int i = 0; i < num_referenced_vertices; i++) {
+            int index = mesh->referenced_vertices[i];
+            mesh->projected_vertices[index] = mat4_mul_vec4(proj_matrix, mesh->transformed_vertices[index]);
+        }
+    }
 
-            // Multiply the world matrix by the original vector
-            transformed_vertex = mat4_mul_vec4(world_matrix, transformed_vertex);
+    uint64_t clip_start_time = get_bench_time();
+    add_bench_stage_time(BENCH_STAGE_TRANSFORM, clip_start_time - transform_start_time);
 
-            // Multiply the view matrix by the vector to transform the scene to camera space
-            transformed_vertex = mat4_mul_vec4(view_matrix, transformed_vertex);
+    // Compute the frustum outcodes of the referenced vertices once, all faces sharing a vertex reuse them
+    if (frustum_test != FRUSTUM_INSIDE) {
+        if (should_clip_homogeneous()) {
+            compute_homogeneous_outcodes(mesh->projected_vertices, mesh->referenced_vertices, mesh->outcodes, num_referenced_vertices);
+        } else {
+            compute_outcodes(mesh->transformed_vertices, mesh->referenced_vertices, mesh->outcodes, num_referenced_vertices);
+        }
+    }
+    add_bench_stage_time(BENCH_STAGE_CLIP, get_bench_time() - clip_start_time);
+
+    // Queue the mesh front faces as geometry jobs of at most FACES_PER_JOB faces each
+    int num_faces = array_length(mesh->front_faces);
+    for (int first_face = 0; first_face < num_faces; first_face += FACES_PER_JOB) {
+        geometry_job_t job = {
+            .mesh = mesh,
+            .mesh_index = mesh_index,
+            .normal_matrix = mat4_transpose(inverse_world_view_matrix),
+            .first_face = first_face,
+            .last_face = MIN(first_face + FACES_PER_JOB, num_faces),
+            .needs_clipping = frustum_test != FRUSTUM_INSIDE
+        };
+        array_push(geometry_jobs, job);
+    }
+}
 
-            // Save transformed vertex in the array of transformed vertices
-            transformed_vertices[v] = transformed_vertex;
+///////////////////////////////////////////////////////////////////////////////
+// Backface cull, clip, and project a range of mesh faces into a triangle bin
+///////////////////////////////////////////////////////////////////////////////
+void process_mesh_faces(mesh_t* mesh, int mesh_index, mat4_t* normal_matrix, int first_face, int last_face, bool needs_clipping, stats_t* stats, uint64_t* clip_time, uint64_t* project_time, screen_triangle_t** bin) {
+    bool clip_homogeneous = should_clip_homogeneous();
+    uint64_t clip_start_time = get_bench_time();
+
+    // Reject the faces outside a frustum plane in one pass, keeping the survivors in order with their clip planes
+    int surviving_faces[FACES_PER_JOB];
+    uint16_t clip_masks[FACES_PER_JOB];
+    int num_faces = last_face - first_face;
+    int num_surviving_faces = num_faces;
+    if (needs_clipping) {
+        num_surviving_faces = compact_surviving_faces(mesh->faces, &mesh->front_faces[first_face], num_faces, mesh->outcodes, get_clip_planes(), surviving_faces, clip_masks);
+        STAT_ADD(stats, STAT_FACES_FRUSTUM_REJECTED, num_faces - num_surviving_faces);
+    } else {
+        for (int i = 0; i < num_faces; i++) {
+            surviving_faces[i] = mesh->front_faces[first_face + i];
+            clip_masks[i] = 0;
         }
+    }
+    *clip_time += get_bench_time() - clip_start_time;
 
-        // Calculate the triangle face normal
-        vec3_t face_normal = get_triangle_normal(transformed_vertices);
+    // Loop all surviving triangle faces in the range
+    for (int i = 0; i < num_surviving_faces; i++) {
+        int face_index = surviving_faces[i];
+        face_t mesh_face = mesh->faces[face_index];
+        int clip_mask = clip_masks[i];
 
-        // Backface culling test to see if the current face should be projected
-        if (should_cull_backface()) {
-            // Find the vector between vertex A in the triangle and the camera origin
-            vec3_t camera_ray = vec3_sub(vec3_new(0, 0, 0), vec3_from_vec4(transformed_vertices[0]));
+        // Fetch the three camera space vertices of this face from the post-transform buffer
+        vec4_t transformed_vertices[3];
+        transformed_vertices[0] = mesh->transformed_vertices[mesh_face.a - 1];
+        transformed_vertices[1] = mesh->transformed_vertices[mesh_face.b - 1];
+        transformed_vertices[2] = mesh->transformed_vertices[mesh_face.c - 1];
 
-            // Calculate how aligned the camera ray is with the face normal (using dot product)
-            float dot_normal_camera = vec3_dot(face_normal, camera_ray);
+        triangle_t triangles_after_clipping[MAX_NUM_POLY_TRIANGLES];
+        int num_triangles_after_clipping = 0;
 
-            // Backface culling, bypassing triangles that are looking away from the camera
-            if (dot_normal_camera < 0) {
-                continue;
+        if (clip_mask == 0) {
+            // The face is inside all planes it must be clipped against, use it as it is without going through a polygon
+            if (clip_homogeneous) {
+                triangles_after_clipping[0].points[0] = mesh->projected_vertices[mesh_face.a - 1];
+                triangles_after_clipping[0].points[1] = mesh->projected_vertices[mesh_face.b - 1];
+                triangles_after_clipping[0].points[2] = mesh->projected_vertices[mesh_face.c - 1];
+            } else {
+                triangles_after_clipping[0].points[0] = transformed_vertices[0];
+                triangles_after_clipping[0].points[1] = transformed_vertices[1];
+                triangles_after_clipping[0].points[2] = transformed_vertices[2];
             }
+            triangles_after_clipping[0].texcoords[0] = mesh_face.a_uv;
+            triangles_after_clipping[0].texcoords[1] = mesh_face.b_uv;
+            triangles_after_clipping[0].texcoords[2] = mesh_face.c_uv;
+            num_triangles_after_clipping = 1;
+            STAT_ADD(stats, STAT_FACES_ACCEPTED, 1);
+        } else if (clip_homogeneous) {
+            // Clip the already projected vertices against the homogeneous planes the face straddles
+            clip_start_time = get_bench_time();
+            homogeneous_polygon_t polygon = homogeneous_polygon_from_triangle(
+                mesh->projected_vertices[mesh_face.a - 1],
+                mesh->projected_vertices[mesh_face.b - 1],
+                mesh->projected_vertices[mesh_face.c - 1],
+                mesh_face.a_uv,
+                mesh_face.b_uv,
+                mesh_face.c_uv
+            );
+            clip_homogeneous_polygon_against_planes(&polygon, clip_mask);
+            STAT_ADD(stats, STAT_FACES_CLIPPED, 1);
+            STAT_ADD(stats, STAT_CLIP_PLANE_PASSES, __builtin_popcount(clip_mask));
+
+            triangles_from_homogeneous_polygon(&polygon, triangles_after_clipping, &num_triangles_after_clipping);
+            *clip_time += get_bench_time() - clip_start_time;
+        } else {
+            // Create a polygon from the original transformed triangle to be clipped
+            clip_start_time = get_bench_time();
+            polygon_t polygon = polygon_from_triangle(
+                vec3_from_vec4(transformed_vertices[0]),
+                vec3_from_vec4(transformed_vertices[1]),
+                vec3_from_vec4(transformed_vertices[2]),
+                mesh_face.a_uv,
+                mesh_face.b_uv,
+                mesh_face.c_uv
+            );
+
+            // Clip the polygon only against the planes it straddles
+            clip_polygon_against_planes(&polygon, clip_mask);
+            STAT_ADD(stats, STAT_FACES_CLIPPED, 1);
+            STAT_ADD(stats, STAT_CLIP_PLANE_PASSES, __builtin_popcount(clip_mask));
+
+            // Break the clipped polygon apart back into a list of triangles
+            triangles_from_polygon(&polygon, triangles_after_clipping, &num_triangles_after_clipping);
+            *clip_time += get_bench_time() - clip_start_time;
         }
-        
-        // Create a polygon from the original transformed triangle to be clipped
-        polygon_t polygon = polygon_from_triangle(
-            vec3_from_vec4(transformed_vertices[0]),
-            vec3_from_vec4(transformed_vertices[1]),
-            vec3_from_vec4(transformed_vertices[2]),
-            mesh_face.a_uv,
-            mesh_face.b_uv,
-            mesh_face.c_uv
-        );
-        
-        // Clip the polygon and returns a new polygon with potential new vertices
-        clip_polygon(&polygon);
-
-        // Break the clipped polygon apart back into a list of triangles
-        triangle_t triangles_after_clipping[MAX_NUM_POLY_TRIANGLES];
-        int num_triangles_after_clipping = 0;
 
-        triangles_from_polygon(&polygon, triangles_after_clipping, &num_triangles_after_clipping);
+        uint64_t project_start_time = get_bench_time();
+
+        // Bring the model space face normal to camera space for lighting, back faces were already culled in model space
+        vec4_t model_normal = mesh->face_planes[face_index];
+        model_normal.w = 0;
+        vec3_t face_normal = vec3_from_vec4(mat4_mul_vec4(*normal_matrix, model_normal));
+        vec3_normalize(&face_normal);
 
         // Loops all the assembled triangles after clipping
+        STAT_ADD(stats, STAT_TRIANGLES_EMITTED, num_triangles_after_clipping);
         for (int triangle_index = 0; triangle_index < num_triangles_after_clipping; triangle_index++) {
             triangle_t triangle_after_clipping = triangles_after_clipping[triangle_index];
 
@@ -252,8 +579,12 @@ void process_graphics_pipeline_stages(mesh_t* mesh) {
 
             // Loop all three vertices to perform projection and conversion to screen space
             for (int v = 0; v < 3; v++) {
-                // Project the current vertex using a perspective projection matrix
-                projected_points[v] = mat4_mul_vec4(proj_matrix, triangle_after_clipping.points[v]);
+                // Project the current vertex using a perspective projection matrix, unless it was projected before clipping
+                if (clip_homogeneous) {
+                    projected_points[v] = triangle_after_clipping.points[v];
+                } else {
+                    projected_points[v] = mat4_mul_vec4(proj_matrix, triangle_after_clipping.points[v]);
+                }
 
                 // Perform perspective divide
                 if (projected_points[v].w != 0) {
@@ -280,34 +611,91 @@ void process_graphics_pipeline_stages(mesh_t* mesh) {
             // Calculate the triangle color based on the light angle
             uint32_t triangle_color = apply_light_intensity(mesh_face.color, light_intensity_factor);
 
-            // Create the final projected triangle that will be rendered in screen space
-            triangle_t triangle_to_render = {
+            // Create the final projected triangle that will be rendered in screen space, keeping 1/w for the rasterizers
+            screen_triangle_t triangle_to_render = {
                 .points = {
-                    { projected_points[0].x, projected_points[0].y, projected_points[0].z, projected_points[0].w },
-                    { projected_points[1].x, projected_points[1].y, projected_points[1].z, projected_points[1].w },
-                    { projected_points[2].x, projected_points[2].y, projected_points[2].z, projected_points[2].w }
+                    { projected_points[0].x, projected_points[0].y, 1 / projected_points[0].w },
+                    { projected_points[1].x, projected_points[1].y, 1 / projected_points[1].w },
+                    { projected_points[2].x, projected_points[2].y, 1 / projected_points[2].w }
                 },
                 .texcoords = {
                     { triangle_after_clipping.texcoords[0].u, triangle_after_clipping.texcoords[0].v },
                     { triangle_after_clipping.texcoords[1].u, triangle_after_clipping.texcoords[1].v },
                     { triangle_after_clipping.texcoords[2].u, triangle_after_clipping.texcoords[2].v }
                 },
-                .color = triangle_color,
-                .texture = mesh->texture
+                .color = triangle_color & 0x00FFFFFF,
+                .mesh_index = mesh_index
             };
 
-            // Save the projected triangle in the array of triangles to render
-            if (triangles_to_render_count < MAX_TRIANGLES) {
-                triangles_to_render[triangles_to_render_count++] = triangle_to_render;
-            }
+            // Save the projected triangle in the triangle bin of this job
+            array_push(*bin, triangle_to_render);
         }
+        *project_time += get_bench_time() - project_start_time;
     }
 }
 
+void process_geometry_job(void* data, int job_index, int thread_index) {
+    geometry_job_t* job = &geometry_jobs[job_index];
+    TRACE_BEGIN(job_zone);
+    uint64_t start_time = get_bench_time();
+    process_mesh_faces(job->mesh, job->mesh_index, &job->normal_matrix, job->first_face, job->last_face, job->needs_clipping, get_thread_stats(thread_index), &job->clip_time, &job->project_time, &geometry_bins[job_index]);
+    job->total_time = get_bench_time() - start_time;
+    TRACE_END(job_zone, "geometry job", job_index);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Run all queued geometry jobs in parallel and merge their bins in job order
+///////////////////////////////////////////////////////////////////////////////
+void run_geometry_jobs(void) {
+    int num_jobs = array_length(geometry_jobs);
+
+    // Make sure there is one bin per job, and empty the bins from the last frame
+    while (array_length(geometry_bins) < num_jobs) {
+        screen_triangle_t* bin = NULL;
+        array_push(geometry_bins, bin);
+    }
+    for (int i = 0; i < num_jobs; i++) {
+        array_reset(geometry_bins[i]);
+    }
+
+    uint64_t start_time = get_bench_time();
+    run_parallel_jobs(process_geometry_job, NULL, num_jobs);
+
+    // Allocate the array of triangles to render from the frame arena, with room for every binned triangle
+    int num_triangles = 0;
+    for (int i = 0; i < num_jobs; i++) {
+        num_triangles += array_length(geometry_bins[i]);
+    }
+    triangles_to_render = arena_alloc(&frame_arena, num_triangles * sizeof(screen_triangle_t));
+
+    // Save the binned triangles in the array of triangles to render
+    for (int i = 0; i < num_jobs; i++) {
+        int num_binned_triangles = array_length(geometry_bins[i]);
+        memcpy(&triangles_to_render[triangles_to_render_count], geometry_bins[i], num_binned_triangles * sizeof(screen_triangle_t));
+        triangles_to_render_count += num_binned_triangles;
+    }
+
+    // The jobs time clipping and projection on their own threads, scale both sums by the same factor from thread time to wall time
+    uint64_t elapsed_time = get_bench_time() - start_time;
+    uint64_t total_job_time = 0;
+    uint64_t total_clip_time = 0;
+    uint64_t total_project_time = 0;
+    for (int i = 0; i < num_jobs; i++) {
+        total_job_time += geometry_jobs[i].total_time;
+        total_clip_time += geometry_jobs[i].clip_time;
+        total_project_time += geometry_jobs[i].project_time;
+    }
+    double wall_time_scale = total_job_time > 0 ? (double)elapsed_time / total_job_time : 0;
+    add_bench_stage_time(BENCH_STAGE_CLIP, (uint64_t)(total_clip_time * wall_time_scale));
+    add_bench_stage_time(BENCH_STAGE_PROJECT, (uint64_t)(total_project_time * wall_time_scale));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Update function frame by frame with a fixed time step
 ///////////////////////////////////////////////////////////////////////////////
 void update(void) {
+    TRACE_BEGIN(update_zone);
+
     // Get a delta time factor converted to seconds to be used to update our game objects
     delta_time = (SDL_GetTicks() - previous_frame_time) / 1000.0;
 
@@ -316,100 +704,297 @@ void update(void) {
     fps++;
     if (previous_frame_time - last_fps >= 1000) {
         //printf("FPS: %u\n", fps);
+
+        // Log the pipeline counters of the last frame, from the mesh culling to the pixels written
+        print_stats();
+
+        // Log the most memory the frame arena handed out in one frame, and how much it keeps reserved
+        printf("Frame arena: %zu KB high-water, %zu KB reserved\n", arena_get_high_water(&frame_arena) / 1024, arena_get_capacity(&frame_arena) / 1024);
         fps = 0;
         last_fps = SDL_GetTicks();
     }
 
-    // Initialize the counter of triangles to render for the current frame
+    // Release the frame memory of the last frame and initialize the counter of triangles to render
+    arena_reset(&frame_arena);
+    triangles_to_render = NULL;
     triangles_to_render_count = 0;
 
+    // Reset the pipeline counters for the current frame
+    reset_stats();
+
+    // Start the frame with no geometry jobs queued
+    array_reset(geometry_jobs);
+
     // Loop all scene meshes
     for (int mesh_index = 0; mesh_index < get_num_meshes(); mesh_index++) {
-        mesh_t* mesh = get_mesh(mesh_index);
-        
         // Process graphics pipeline stages for each mesh
-        process_graphics_pipeline_stages(mesh);
+        TRACE_BEGIN(mesh_zone);
+        process_graphics_pipeline_stages(mesh_index);
+        TRACE_END(mesh_zone, "mesh", mesh_index);
     }
+
+    // Process the faces of all meshes on the thread pool
+    run_geometry_jobs();
+    TRACE_END(update_zone, "update", TRACE_NO_ARG);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Render function to draw objects on the display
+// Rasterize all the triangles binned into one screen tile
 ///////////////////////////////////////////////////////////////////////////////
-void render(void) {
-    // Clear all the arrays to get ready for the next frame
-    clear_color_buffer(0xFF000000);
-    clear_z_buffer();
-    
-    draw_grid();
+// Every tile job only writes the color and depth of the pixels inside its own
+// tile, so tiles can be rendered by different threads without any locking.
+///////////////////////////////////////////////////////////////////////////////
+void render_tile_job(void* data, int tile_index, int thread_index) {
+    TRACE_BEGIN(tile_zone);
+    tile_t* tile = get_tile(tile_index);
+
+    int num_tile_triangles = array_length(tile->triangles);
+
+    // Depth pre-pass, fill the z-buffer of the tile so only the visible pixels are shaded afterwards
+    int depth_test = DEPTH_TEST_LESS;
+    if (should_render_depth_prepass()) {
+        for (int i = 0; i < num_tile_triangles; i++) {
+            screen_triangle_t* triangle = &triangles_to_render[tile->triangles[i]];
+            draw_depth_triangle(&triangle->points[0], &triangle->points[1], &triangle->points[2], &tile->rect);
+        }
+        depth_test = DEPTH_TEST_EQUAL;
+    }
 
-    // Loop all triangles from the triangles_to_render array
-    for (int i = 0; i < triangles_to_render_count; i++) {
-        triangle_t triangle = triangles_to_render[i];
+    // Loop all triangles binned into this tile, in the order they were submitted
+    for (int i = 0; i < num_tile_triangles; i++) {
+        screen_triangle_t* triangle = &triangles_to_render[tile->triangles[i]];
 
         // Draw filled triangle
         if (should_render_filled_triangle()) {
-            vec4_t v0 = { triangle.points[0].x, triangle.points[0].y, triangle.points[0].z, triangle.points[0].w }; // vertex A
-            vec4_t v1 = { triangle.points[1].x, triangle.points[1].y, triangle.points[1].z, triangle.points[1].w }; // vertex B
-            vec4_t v2 = { triangle.points[2].x, triangle.points[2].y, triangle.points[2].z, triangle.points[2].w }; // vertex C
-            draw_filled_triangle(&v0, &v1, &v2, triangle.color);
+            draw_filled_triangle(&triangle->points[0], &triangle->points[1], &triangle->points[2], 0xFF000000 | triangle->color, &tile->rect);
         }
 
         // Draw textured triangle
         if (should_render_textured_triangle()) {
-            vec4_t v0 = { triangle.points[0].x, triangle.points[0].y, triangle.points[0].z, triangle.points[0].w }; // vertex A
-            vec4_t v1 = { triangle.points[1].x, triangle.points[1].y, triangle.points[1].z, triangle.points[1].w }; // vertex B
-            vec4_t v2 = { triangle.points[2].x, triangle.points[2].y, triangle.points[2].z, triangle.points[2].w }; // vertex C
             draw_textured_triangle(
-                &v0, triangle.texcoords[0].u, triangle.texcoords[0].v,
-                &v1, triangle.texcoords[1].u, triangle.texcoords[1].v,
-                &v2, triangle.texcoords[2].u, triangle.texcoords[2].v,
-                triangle.texture
+                &triangle->points[0], triangle->texcoords[0].u, triangle->texcoords[0].v,
+                &triangle->points[1], triangle->texcoords[1].u, triangle->texcoords[1].v,
+                &triangle->points[2], triangle->texcoords[2].u, triangle->texcoords[2].v,
+                get_mesh(triangle->mesh_index)->texture,
+                depth_test,
+                &tile->rect
             );
         }
+    }
+
+    // The triangles counted the depth tests of every pixel as they were drawn, show them as a heatmap instead
+    if (should_render_overdraw()) {
+        draw_overdraw_heatmap(&tile->rect);
+    }
+    TRACE_END(tile_zone, "tile", tile_index);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Render function to draw objects on the display
+///////////////////////////////////////////////////////////////////////////////
+void render(void) {
+    TRACE_BEGIN(render_zone);
+    uint64_t raster_start_time = get_bench_time();
+
+    // Clear all the arrays to get ready for the next frame
+    clear_color_buffer(0xFF000000);
+    clear_z_buffer();
+    
+    draw_grid();
+
+    // Bin the filled and textured triangles into screen tiles and rasterize the tiles in parallel
+    if (should_render_filled_triangle() || should_render_textured_triangle()) {
+        bin_triangles(triangles_to_render, triangles_to_render_count);
+        run_parallel_jobs(render_tile_job, NULL, get_num_tiles());
+    }
+
+    // Loop all triangles from the triangles_to_render array to draw wireframes on top
+    for (int i = 0; i < triangles_to_render_count; i++) {
+        screen_triangle_t* triangle = &triangles_to_render[i];
 
         // Draw triangle wireframe
         if (should_render_wire()) {
-            vec2_t v0 = { triangle.points[0].x, triangle.points[0].y }; // Vertex A
-            vec2_t v1 = { triangle.points[1].x, triangle.points[1].y }; // Vertex B
-            vec2_t v2 = { triangle.points[2].x, triangle.points[2].y }; // Vertex C
+            vec2_t v0 = { triangle->points[0].x, triangle->points[0].y }; // Vertex A
+            vec2_t v1 = { triangle->points[1].x, triangle->points[1].y }; // Vertex B
+            vec2_t v2 = { triangle->points[2].x, triangle->points[2].y }; // Vertex C
             draw_wire_triangle(&v0, &v1, &v2, 0xFFFFFFFF);
         }
 
         // Draw triangle vertex points
         if (should_render_wire_vertex()) {
-            draw_rect(triangle.points[0].x - 3, triangle.points[0].y - 3, 6, 6, 0xFF0000FF); // vertex A
-            draw_rect(triangle.points[1].x - 3, triangle.points[1].y - 3, 6, 6, 0xFF0000FF); // vertex B
-            draw_rect(triangle.points[2].x - 3, triangle.points[2].y - 3, 6, 6, 0xFF0000FF); // vertex C
+            draw_rect(triangle->points[0].x - 3, triangle->points[0].y - 3, 6, 6, 0xFF0000FF); // vertex A
+            draw_rect(triangle->points[1].x - 3, triangle->points[1].y - 3, 6, 6, 0xFF0000FF); // vertex B
+            draw_rect(triangle->points[2].x - 3, triangle->points[2].y - 3, 6, 6, 0xFF0000FF); // vertex C
         }
     }
 
+    uint64_t present_start_time = get_bench_time();
+    add_bench_stage_time(BENCH_STAGE_RASTER, present_start_time - raster_start_time);
+
     // Finally draw the color buffer to the SDL window
     render_color_buffer();
+    add_bench_stage_time(BENCH_STAGE_PRESENT, get_bench_time() - present_start_time);
+    TRACE_END(render_zone, "render", TRACE_NO_ARG);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Free the memory that was dynamically allocated by the program
 ///////////////////////////////////////////////////////////////////////////////
 void free_resources(void) {
+    destroy_thread_pool();
+    free_tiles();
+    for (int i = 0; i < array_length(geometry_bins); i++) {
+        array_free(geometry_bins[i]);
+    }
+    array_free(geometry_bins);
+    array_free(geometry_jobs);
+    arena_free(&frame_arena);
+    free_camera_path();
+    free_bench();
     free_meshes();
     destroy_window();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Parse the command line options, returning false if they are not valid
+///////////////////////////////////////////////////////////////////////////////
+// --headless            render offscreen as fast as possible, with no window
+// --frames <count>      stop after this many frames (default 300 when headless)
+// --dump <prefix>       save each headless frame as <prefix>_<frame>.ppm
+// --scene <name>        load a scene from scene.c, or ./assets/<name>.obj
+// --camera-path <path>  move the camera along "orbit", "dolly", or a recorded file
+// --record <file>       save the camera pose of every frame, to replay as a path
+// --bench <file.json>   time the frames and their stages, and write the results
+// --trace <file.json>   write the zones of the last frames as a Chrome trace on exit
+///////////////////////////////////////////////////////////////////////////////
+bool parse_arguments(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            max_frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dump_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            scene_name = argv[++i];
+        } else if (strcmp(argv[i], "--camera-path") == 0 && i + 1 < argc) {
+            camera_path = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_filename = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_filename = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_filename = argv[++i];
+        } else {
+            fprintf(stderr,
+                "Usage: %s [--headless] [--frames <count>] [--dump <prefix>] [--scene <name>]\n"
+                "       [--camera-path <orbit|dolly|file>] [--record <file>] [--bench <file.json>]\n"
+                "       [--trace <file.json>]\n",
+                argv[0]
+            );
+            return false;
+        }
+    }
+    if (headless && max_frames == 0) {
+        max_frames = DEFAULT_HEADLESS_FRAMES;
+    }
+    return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Main function
 ///////////////////////////////////////////////////////////////////////////////
-int main(void) {
-    is_running = init_window();
+int main(int argc, char* argv[]) {
+    if (!parse_arguments(argc, argv)) {
+        return 1;
+    }
+
+    bool is_initialized = (headless ? init_headless() : init_window()) && setup();
+    is_running = is_initialized;
+
+    FILE* record_file = NULL;
+    if (record_filename != NULL) {
+        record_file = fopen(record_filename, "w");
+        if (record_file == NULL) {
+            fprintf(stderr, "Error creating %s.\n", record_filename);
+            is_running = false;
+        }
+    }
 
-    setup();
+    // Benchmarks render a few frames at the start of the camera path before timing anything
+    int warmup_frames = bench_filename != NULL ? BENCH_WARMUP_FRAMES : 0;
+    int path_frames = max_frames > 0 ? max_frames : DEFAULT_CAMERA_PATH_FRAMES;
 
+    uint64_t start_time = SDL_GetPerformanceCounter();
+    int num_frames = 0;
     while (is_running) {
-        process_input();
+        TRACE_BEGIN(frame_zone);
+
+        // There are no input events without a window
+        if (!headless) {
+            process_input();
+        }
+
+        // Move the camera along its path, the same way on every run
+        int path_frame = MAX(num_frames - warmup_frames, 0) % path_frames;
+        update_camera_path(path_frame, path_frames, get_scene_center());
+        if (record_file != NULL) {
+            fprintf(record_file, "%.9g %.9g %.9g %.9g %.9g\n",
+                get_camera_position().x, get_camera_position().y, get_camera_position().z,
+                get_camera_yaw(), get_camera_pitch()
+            );
+        }
+
+        uint64_t frame_start_time = get_bench_time();
         update();
         render();
+        uint64_t frame_time = get_bench_time() - frame_start_time;
+        num_frames++;
+
+        if (bench_filename != NULL && num_frames > warmup_frames) {
+            end_bench_frame(frame_time);
+        } else {
+            reset_bench();
+        }
+
+        if (headless && dump_prefix != NULL) {
+            char filename[1024];
+            snprintf(filename, sizeof(filename), "%s_%04d.ppm", dump_prefix, num_frames);
+            if (!save_color_buffer(filename)) {
+                fprintf(stderr, "Error saving frame %s.\n", filename);
+                is_running = false;
+            }
+        }
+        if (max_frames > 0 && num_frames >= max_frames + warmup_frames) {
+            is_running = false;
+        }
+        TRACE_END(frame_zone, "frame", num_frames);
+    }
+
+    if (record_file != NULL) {
+        fclose(record_file);
+    }
+
+    // Report the frame and stage timings of the benchmark
+    if (bench_filename != NULL) {
+        print_bench_summary();
+        if (!write_bench_json(bench_filename, scene_name, camera_path)) {
+            fprintf(stderr, "Error writing %s.\n", bench_filename);
+        }
+    }
+
+    // Save the timeline of the last frames, to open in Perfetto or chrome://tracing
+    if (trace_filename != NULL && !write_trace_json(trace_filename)) {
+        fprintf(stderr, "Error writing %s.\n", trace_filename);
+    }
+
+    // Report the raw frame rate of the headless renderer, which is not limited by vsync
+    if (headless && num_frames > 0) {
+        double seconds = (double)(SDL_GetPerformanceCounter() - start_time) / SDL_GetPerformanceFrequency();
+        printf("Rendered %d frames in %.3f s: %.2f ms per frame, %.1f FPS\n", num_frames, seconds, seconds * 1000 / num_frames, num_frames / seconds);
     }
 
     free_resources();
 
-    return 0;
+    return is_initialized ? 0 : 1;
 }
@@ -0,0 +1,18 @@
+#include "matrix.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// External definitions of the inline functions declared in matrix.h, used
+// whenever the compiler decides not to inline a call
+///////////////////////////////////////////////////////////////////////////////
+extern mat4_t mat4_identity(void);
+extern mat4_t mat4_make_scale(float sx, float sy, float sz);
+extern mat4_t mat4_make_translation(float tx, float ty, float tz);
+extern mat4_t mat4_make_rotation_x(float angle);
+extern mat4_t mat4_make_rotation_y(float angle);
+extern mat4_t mat4_make_rotation_z(float angle);
+extern vec4_t mat4_mul_vec4(mat4_t m, vec4_t v);
+extern mat4_t mat4_mul_mat4(mat4_t a, mat4_t b);
+extern mat4_t mat4_make_perspective(float fov, float aspect, float znear, float zfar);
+extern mat4_t mat4_look_at(vec3_t eye, vec3_t target, vec3_t up);
+extern mat4_t mat4_transpose(mat4_t m);
+extern mat4_t mat4_inverse(mat4_t m);
@@ -145,4 +145,66 @@ inline mat4_t mat4_look_at(vec3_t eye, vec3_t target, vec3_t up) {
     return view_matrix;
 }
 
+inline mat4_t mat4_transpose(mat4_t m) {
+    mat4_t result;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            result.m[i][j] = m.m[j][i];
+        }
+    }
+    return result;
+}
+
+inline mat4_t mat4_inverse(mat4_t m) {
+    // Inverse by cofactors: inverse = adjugate / determinant, where each 2x2
+    // minor of the top and bottom row pairs is shared by several cofactors
+    float s0 = m.m[0][0] * m.m[1][1] - m.m[1][0] * m.m[0][1];
+    float s1 = m.m[0][0] * m.m[1][2] - m.m[1][0] * m.m[0][2];
+    float s2 = m.m[0][0] * m.m[1][3] - m.m[1][0] * m.m[0][3];
+    float s3 = m.m[0][1] * m.m[1][2] - m.m[1][1] * m.m[0][2];
+    float s4 = m.m[0][1] * m.m[1][3] - m.m[1][1] * m.m[0][3];
+    float s5 = m.m[0][2] * m.m[1][3] - m.m[1][2] * m.m[0][3];
+    float c5 = m.m[2][2] * m.m[3][3] - m.m[3][2] * m.m[2][3];
+    float c4 = m.m[2][1] * m.m[3][3] - m.m[3][1] * m.m[2][3];
+    float c3 = m.m[2][1] * m.m[3][2] - m.m[3][1] * m.m[2][2];
+    float c2 = m.m[2][0] * m.m[3][3] - m.m[3][0] * m.m[2][3];
+    float c1 = m.m[2][0] * m.m[3][2] - m.m[3][0] * m.m[2][2];
+    float c0 = m.m[2][0] * m.m[3][1] - m.m[3][0] * m.m[2][1];
+
+    // A singular matrix has no inverse, return the identity instead
+    float determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (determinant == 0) {
+        return mat4_identity();
+    }
+    float inv_det = 1.0 / determinant;
+
+    mat4_t result = {{
+        {
+            ( m.m[1][1] * c5 - m.m[1][2] * c4 + m.m[1][3] * c3) * inv_det,
+            (-m.m[0][1] * c5 + m.m[0][2] * c4 - m.m[0][3] * c3) * inv_det,
+            ( m.m[3][1] * s5 - m.m[3][2] * s4 + m.m[3][3] * s3) * inv_det,
+            (-m.m[2][1] * s5 + m.m[2][2] * s4 - m.m[2][3] * s3) * inv_det
+        },
+        {
+            (-m.m[1][0] * c5 + m.m[1][2] * c2 - m.m[1][3] * c1) * inv_det,
+            ( m.m[0][0] * c5 - m.m[0][2] * c2 + m.m[0][3] * c1) * inv_det,
+            (-m.m[3][0] * s5 + m.m[3][2] * s2 - m.m[3][3] * s1) * inv_det,
+            ( m.m[2][0] * s5 - m.m[2][2] * s2 + m.m[2][3] * s1) * inv_det
+        },
+        {
+            ( m.m[1][0] * c4 - m.m[1][1] * c2 + m.m[1][3] * c0) * inv_det,
+            (-m.m[0][0] * c4 + m.m[0][1] * c2 - m.m[0][3] * c0) * inv_det,
+            ( m.m[3][0] * s4 - m.m[3][1] * s2 + m.m[3][3] * s0) * inv_det,
+            (-m.m[2][0] * s4 + m.m[2][1] * s2 - m.m[2][3] * s0) * inv_det
+        },
+        {
+            (-m.m[1][0] * c3 + m.m[1][1] * c1 - m.m[1][2] * c0) * inv_det,
+            ( m.m[0][0] * c3 - m.m[0][1] * c1 + m.m[0][2] * c0) * inv_det,
+            (-m.m[3][0] * s3 + m.m[3][1] * s1 - m.m[3][2] * s0) * inv_det,
+            ( m.m[2][0] * s3 - m.m[2][1] * s1 + m.m[2][2] * s0) * inv_det
+        }
+    }};
+    return result;
+}
+
 #endif
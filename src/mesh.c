@@ -2,79 +2,81 @@
 #include <string.h>
 #include "array.h"
 #include "mesh.h"
+#include "obj.h"
 
-#define MAX_NUM_MESHES 100
+#define MAX_NUM_MESHES 100 // At most 256, the mesh index of a screen_triangle_t has 8 bits
 static mesh_t meshes[MAX_NUM_MESHES];
 static int mesh_count = 0;
 
 void load_mesh_obj_data(mesh_t* mesh, char* obj_filename) {
-    FILE* file = fopen(obj_filename, "r");
-    char line[1024];
-    tex2_t* texcoords = NULL;
-
-    while (fgets(line, 1024, file)) {
-        // Vertex information
-        if (strncmp(line, "v ", 2) == 0) {
-            vec3_t vertex;
-            sscanf(line, "v %f %f %f", &vertex.x, &vertex.y, &vertex.z);
-            array_push(meshes[mesh_count].vertices, vertex);
-        }
-        // Texture coordinate information
-        else if (strncmp(line, "vt ", 3) == 0) {
-            tex2_t texcoord;
-            sscanf(line, "vt %f %f", &texcoord.u, &texcoord.v);
-            array_push(texcoords, texcoord);
-        }
-        // Face information
-        else if (strncmp(line, "f ", 2) == 0) {
-            int v[4], vt[4], vn[4];
-            int count = sscanf(
-                line, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-                &v[0], &vt[0], &vn[0],
-                &v[1], &vt[1], &vn[1],
-                &v[2], &vt[2], &vn[2],
-                &v[3], &vt[3], &vn[3]
-            );
-
-            if (count == 9) {
-                // Triangle
-                face_t face = {
-                    .a = v[0],
-                    .b = v[1],
-                    .c = v[2],
-                    .a_uv = texcoords[vt[0] - 1],
-                    .b_uv = texcoords[vt[1] - 1],
-                    .c_uv = texcoords[vt[2] - 1],
-                    .color = 0xFFFFFFFF
-                };
-                array_push(meshes[mesh_count].faces, face);
-            } else if (count == 12) {
-                // Quad split into two triangles: [0,1,2] and [0,2,3]
-                face_t face1 = {
-                    .a = v[0],
-                    .b = v[1],
-                    .c = v[2],
-                    .a_uv = texcoords[vt[0] - 1],
-                    .b_uv = texcoords[vt[1] - 1],
-                    .c_uv = texcoords[vt[2] - 1],
-                    .color = 0xFFFFFFFF
-                };
-                face_t face2 = {
-                    .a = v[0],
-                    .b = v[2],
-                    .c = v[3],
-                    .a_uv = texcoords[vt[0] - 1],
-                    .b_uv = texcoords[vt[2] - 1],
-                    .c_uv = texcoords[vt[3] - 1],
-                    .color = 0xFFFFFFFF
-                };
-                array_push(meshes[mesh_count].faces, face1);
-                array_push(meshes[mesh_count].faces, face2);
-            }
-        }
+    if (!load_obj_file(obj_filename, &mesh->vertices, &mesh->faces)) {
+        fprintf(stderr, "Error reading %s.\n", obj_filename);
+    }
+
+    // Build a structure-of-arrays copy of the vertex positions for the batch transform kernels
+    int num_vertices = array_length(mesh->vertices);
+    mesh->vertices_x = array_hold(NULL, num_vertices, sizeof(float));
+    mesh->vertices_y = array_hold(NULL, num_vertices, sizeof(float));
+    mesh->vertices_z = array_hold(NULL, num_vertices, sizeof(float));
+    for (int i = 0; i < num_vertices; i++) {
+        mesh->vertices_x[i] = mesh->vertices[i].x;
+        mesh->vertices_y[i] = mesh->vertices[i].y;
+        mesh->vertices_z[i] = mesh->vertices[i].z;
+    }
+
+    compute_mesh_bounds(mesh);
+    compute_face_planes(mesh);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Compute the model space bounding box of the mesh vertices, and a bounding
+// sphere centered in the box that encloses all of them
+///////////////////////////////////////////////////////////////////////////////
+void compute_mesh_bounds(mesh_t* mesh) {
+    int num_vertices = array_length(mesh->vertices);
+    if (num_vertices == 0) {
+        mesh->bounds_min = mesh->bounds_max = mesh->bounds_center = vec3_new(0, 0, 0);
+        mesh->bounds_radius = 0;
+        return;
+    }
+
+    mesh->bounds_min = mesh->bounds_max = mesh->vertices[0];
+    for (int i = 1; i < num_vertices; i++) {
+        vec3_t v = mesh->vertices[i];
+        mesh->bounds_min = vec3_new(fmin(mesh->bounds_min.x, v.x), fmin(mesh->bounds_min.y, v.y), fmin(mesh->bounds_min.z, v.z));
+        mesh->bounds_max = vec3_new(fmax(mesh->bounds_max.x, v.x), fmax(mesh->bounds_max.y, v.y), fmax(mesh->bounds_max.z, v.z));
+    }
+
+    mesh->bounds_center = vec3_mul(vec3_add(mesh->bounds_min, mesh->bounds_max), 0.5);
+    mesh->bounds_radius = 0;
+    for (int i = 0; i < num_vertices; i++) {
+        mesh->bounds_radius = fmax(mesh->bounds_radius, vec3_length(vec3_sub(mesh->vertices[i], mesh->bounds_center)));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Compute the model space plane of every face, with the normal computed the
+// same way as get_triangle_normal. A point p is in front of the face when
+// dot(normal, p) + distance >= 0, which lets faces be backface culled against
+// the camera position in model space before any vertex is transformed.
+///////////////////////////////////////////////////////////////////////////////
+void compute_face_planes(mesh_t* mesh) {
+    int num_faces = array_length(mesh->faces);
+    mesh->face_planes = array_hold(NULL, num_faces, sizeof(vec4_t));
+    for (int i = 0; i < num_faces; i++) {
+        vec4_t vertices[3] = {
+            vec4_from_vec3(mesh->vertices[mesh->faces[i].a - 1]),
+            vec4_from_vec3(mesh->vertices[mesh->faces[i].b - 1]),
+            vec4_from_vec3(mesh->vertices[mesh->faces[i].c - 1])
+        };
+        vec3_t normal = get_triangle_normal(vertices);
+        mesh->face_planes[i] = (vec4_t) {
+            normal.x,
+            normal.y,
+            normal.z,
+            -vec3_dot(normal, vec3_from_vec4(vertices[0]))
+        };
     }
-    array_free(texcoords);
-    fclose(file);
 }
 
 void load_mesh_png_data(mesh_t* mesh, char* png_filename) {
@@ -87,9 +89,29 @@ void load_mesh_png_data(mesh_t* mesh, char* png_filename) {
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Load the meshlets precomputed by the meshlet tool next to the OBJ file, or
+// build them now if the file is missing or out of date
+///////////////////////////////////////////////////////////////////////////////
+void load_mesh_meshlets(mesh_t* mesh, char* obj_filename) {
+    char meshlet_filename[1024];
+    get_meshlet_filename(obj_filename, meshlet_filename, sizeof(meshlet_filename));
+    if (!load_meshlets(meshlet_filename, mesh->vertices, mesh->faces, &mesh->meshlets, &mesh->meshlet_faces)) {
+        build_meshlets(mesh->vertices, mesh->faces, mesh->face_planes, &mesh->meshlets, &mesh->meshlet_faces);
+    }
+}
+
 void load_mesh(char* obj_filename, char* png_filename, vec3_t scale, vec3_t translation, vec3_t rotation) {
     load_mesh_obj_data(&meshes[mesh_count], obj_filename);
     load_mesh_png_data(&meshes[mesh_count], png_filename);
+    load_mesh_meshlets(&meshes[mesh_count], obj_filename);
+
+    // Allocate the post-transform buffer with one entry per mesh vertex
+    int num_vertices = array_length(meshes[mesh_count].vertices);
+    meshes[mesh_count].transformed_vertices = array_hold(NULL, num_vertices, sizeof(vec4_t));
+    meshes[mesh_count].projected_vertices = array_hold(NULL, num_vertices, sizeof(vec4_t));
+    meshes[mesh_count].outcodes = array_hold(NULL, num_vertices, sizeof(uint16_t));
+    meshes[mesh_count].vertex_marks = array_hold(NULL, num_vertices, sizeof(uint8_t));
 
     meshes[mesh_count].scale = scale;
     meshes[mesh_count].translation = translation;
@@ -122,6 +144,18 @@ void free_meshes(void) {
     for (int i = 0; i < mesh_count; i++) {
         array_free(meshes[i].faces);
         array_free(meshes[i].vertices);
+        array_free(meshes[i].vertices_x);
+        array_free(meshes[i].vertices_y);
+        array_free(meshes[i].vertices_z);
+        array_free(meshes[i].transformed_vertices);
+        array_free(meshes[i].projected_vertices);
+        array_free(meshes[i].outcodes);
+        array_free(meshes[i].face_planes);
+        array_free(meshes[i].meshlets);
+        array_free(meshes[i].meshlet_faces);
+        array_free(meshes[i].front_faces);
+        array_free(meshes[i].referenced_vertices);
+        array_free(meshes[i].vertex_marks);
         upng_free(meshes[i].texture);
     }
 }
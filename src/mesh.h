@@ -4,18 +4,38 @@
 #include "vector.h"
 #include "triangle.h"
 #include "upng.h"
+#include "meshlet.h"
 
 typedef struct {
-    vec3_t* vertices;         // mesh dynamic array of vertices
-    face_t* faces;            // mesh dynamic array of faces
-    upng_t* texture;          // mesh PNG texture
-    vec3_t scale;             // mesh scale in x, y, and z
-    vec3_t rotation;          // mesh rotation in x, y, and z
-    vec3_t translation;       // mesh translation in x, y, and z
+    vec3_t* vertices;              // mesh dynamic array of vertices
+    float* vertices_x;             // mesh vertex x positions as a structure-of-arrays copy
+    float* vertices_y;             // mesh vertex y positions as a structure-of-arrays copy
+    float* vertices_z;             // mesh vertex z positions as a structure-of-arrays copy
+    vec4_t* transformed_vertices;  // mesh vertices transformed to camera space every frame
+    vec4_t* projected_vertices;    // mesh vertices projected to homogeneous clip space, when clipping there
+    uint16_t* outcodes;            // mesh frustum outcodes of the transformed vertices
+    vec3_t bounds_min;             // mesh model space axis-aligned bounding box minimum corner
+    vec3_t bounds_max;             // mesh model space axis-aligned bounding box maximum corner
+    vec3_t bounds_center;          // mesh model space bounding sphere center
+    float bounds_radius;           // mesh model space bounding sphere radius
+    face_t* faces;                 // mesh dynamic array of faces
+    vec4_t* face_planes;           // mesh model space face planes, unit normal in xyz and distance in w
+    meshlet_t* meshlets;           // mesh clusters of adjacent faces with bounds and normal cones
+    int* meshlet_faces;            // mesh face indices of all meshlets, each meshlet is a contiguous range
+    int* front_faces;              // mesh indices of the faces facing the camera in the current frame
+    int* referenced_vertices;      // mesh indices of the vertices used by the front faces
+    uint8_t* vertex_marks;         // mesh flags of the vertices already in referenced_vertices
+    upng_t* texture;               // mesh PNG texture
+    vec3_t scale;                  // mesh scale in x, y, and z
+    vec3_t rotation;               // mesh rotation in x, y, and z
+    vec3_t translation;            // mesh translation in x, y, and z
 } mesh_t;
 
 void load_mesh_obj_data(mesh_t* mesh, char* obj_filename);
 void load_mesh_png_data(mesh_t* mesh, char* png_filename);
+void load_mesh_meshlets(mesh_t* mesh, char* obj_filename);
+void compute_mesh_bounds(mesh_t* mesh);
+void compute_face_planes(mesh_t* mesh);
 
 void load_mesh(char* obj_filename, char* png_filename, vec3_t scale, vec3_t translation, vec3_t rotation);
 
@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "array.h"
+#include "meshlet.h"
+
+static bool meshlet_culling = true;
+
+///////////////////////////////////////////////////////////////////////////////
+// Meshlet culling rejects whole clusters of faces with one normal cone test
+// and one bounding sphere test, before their faces are visited one by one
+///////////////////////////////////////////////////////////////////////////////
+void set_meshlet_culling(bool enabled) {
+    meshlet_culling = enabled;
+}
+
+bool should_cull_meshlets(void) {
+    return meshlet_culling;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Compute the bounding sphere and the normal cone of a meshlet
+///////////////////////////////////////////////////////////////////////////////
+// The cone axis is the normalized sum of the face normals, and the cutoff is
+// the sine of the angle between the axis and the furthest normal. A cone
+// wider than ~84 degrees (or with degenerate faces) can never be culled.
+///////////////////////////////////////////////////////////////////////////////
+static void compute_meshlet_bounds(meshlet_t* meshlet, vec3_t* vertices, face_t* faces, vec4_t* face_planes, int* meshlet_faces) {
+    int* indices = &meshlet_faces[meshlet->first_face];
+
+    vec3_t min = vertices[faces[indices[0]].a - 1];
+    vec3_t max = min;
+    vec3_t normal_sum = vec3_new(0, 0, 0);
+    for (int i = 0; i < meshlet->num_faces; i++) {
+        face_t* face = &faces[indices[i]];
+        int corners[3] = { face->a - 1, face->b - 1, face->c - 1 };
+        for (int j = 0; j < 3; j++) {
+            vec3_t v = vertices[corners[j]];
+            min = vec3_new(fmin(min.x, v.x), fmin(min.y, v.y), fmin(min.z, v.z));
+            max = vec3_new(fmax(max.x, v.x), fmax(max.y, v.y), fmax(max.z, v.z));
+        }
+        normal_sum = vec3_add(normal_sum, vec3_from_vec4(face_planes[indices[i]]));
+    }
+
+    meshlet->center = vec3_mul(vec3_add(min, max), 0.5);
+    meshlet->radius = 0;
+    for (int i = 0; i < meshlet->num_faces; i++) {
+        face_t* face = &faces[indices[i]];
+        int corners[3] = { face->a - 1, face->b - 1, face->c - 1 };
+        for (int j = 0; j < 3; j++) {
+            meshlet->radius = fmax(meshlet->radius, vec3_length(vec3_sub(vertices[corners[j]], meshlet->center)));
+        }
+    }
+
+    meshlet->cone_axis = normal_sum;
+    vec3_normalize(&meshlet->cone_axis);
+    float min_dot = 1;
+    for (int i = 0; i < meshlet->num_faces; i++) {
+        float dot = vec3_dot(meshlet->cone_axis, vec3_from_vec4(face_planes[indices[i]]));
+        if (!(dot >= min_dot)) {
+            min_dot = dot;
+        }
+    }
+    meshlet->cone_cutoff = min_dot > 0.1 ? sqrt(1 - min_dot * min_dot) : 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Partition the mesh faces into meshlets
+///////////////////////////////////////////////////////////////////////////////
+// Each meshlet starts at the first face that has no meshlet yet, and grows
+// breadth-first through faces sharing a vertex, as long as their normal is
+// close to the normal of the first face and the meshlet has room left. When
+// the breadth-first search runs out of faces, it restarts from the faces that
+// follow the first one in file order, which are usually close by. The face
+// indices of each meshlet are stored contiguously in meshlet_faces.
+///////////////////////////////////////////////////////////////////////////////
+void build_meshlets(vec3_t* vertices, face_t* faces, vec4_t* face_planes, meshlet_t** meshlets, int** meshlet_faces) {
+    int num_vertices = array_length(vertices);
+    int num_faces = array_length(faces);
+    array_reset(*meshlets);
+    array_reset(*meshlet_faces);
+    if (num_faces <= 0) {
+        return;
+    }
+
+    // Build the list of faces around each vertex, with vertex_offsets[v] pointing to the first one
+    int* vertex_offsets = array_hold(NULL, num_vertices + 1, sizeof(int));
+    int* vertex_faces = array_hold(NULL, num_faces * 3, sizeof(int));
+    memset(vertex_offsets, 0, (num_vertices + 1) * sizeof(int));
+    for (int i = 0; i < num_faces; i++) {
+        vertex_offsets[faces[i].a]++;
+        vertex_offsets[faces[i].b]++;
+        vertex_offsets[faces[i].c]++;
+    }
+    for (int v = 0; v < num_vertices; v++) {
+        vertex_offsets[v + 1] += vertex_offsets[v];
+    }
+    for (int i = num_faces - 1; i >= 0; i--) {
+        vertex_faces[--vertex_offsets[faces[i].a]] = i;
+        vertex_faces[--vertex_offsets[faces[i].b]] = i;
+        vertex_faces[--vertex_offsets[faces[i].c]] = i;
+    }
+    // After the loop above vertex_offsets[v] is the first face of vertex v - 1, shift it back
+    for (int v = 0; v < num_vertices; v++) {
+        vertex_offsets[v] = vertex_offsets[v + 1];
+    }
+    vertex_offsets[num_vertices] = num_faces * 3;
+
+    bool* assigned = array_hold(NULL, num_faces, sizeof(bool));
+    memset(assigned, 0, num_faces * sizeof(bool));
+
+    for (int seed = 0; seed < num_faces; seed++) {
+        if (assigned[seed]) {
+            continue;
+        }
+
+        meshlet_t meshlet = { .first_face = array_length(*meshlet_faces), .num_faces = 1 };
+        vec3_t seed_normal = vec3_from_vec4(face_planes[seed]);
+        assigned[seed] = true;
+        array_push(*meshlet_faces, seed);
+
+        // The faces already in the meshlet double as the breadth-first queue. UV seams split the
+        // vertices of OBJ files, so when no neighbor is left the next faces in file order are tried
+        int window = seed + 1;
+        for (int next = 0; next < meshlet.num_faces && meshlet.num_faces < MESHLET_MAX_FACES; next++) {
+            face_t* face = &faces[(*meshlet_faces)[meshlet.first_face + next]];
+            int corners[3] = { face->a - 1, face->b - 1, face->c - 1 };
+            for (int j = 0; j < 3 && meshlet.num_faces < MESHLET_MAX_FACES; j++) {
+                for (int k = vertex_offsets[corners[j]]; k < vertex_offsets[corners[j] + 1] && meshlet.num_faces < MESHLET_MAX_FACES; k++) {
+                    int neighbor = vertex_faces[k];
+                    if (assigned[neighbor] || !(vec3_dot(seed_normal, vec3_from_vec4(face_planes[neighbor])) >= MESHLET_MIN_NORMAL_DOT)) {
+                        continue;
+                    }
+                    assigned[neighbor] = true;
+                    array_push(*meshlet_faces, neighbor);
+                    meshlet.num_faces++;
+                }
+            }
+            for (; next == meshlet.num_faces - 1 && meshlet.num_faces < MESHLET_MAX_FACES && window < MIN(seed + MESHLET_WINDOW_FACES, num_faces); window++) {
+                if (!assigned[window] && vec3_dot(seed_normal, vec3_from_vec4(face_planes[window])) >= MESHLET_MIN_NORMAL_DOT) {
+                    assigned[window] = true;
+                    array_push(*meshlet_faces, window);
+                    meshlet.num_faces++;
+                }
+            }
+        }
+
+        compute_meshlet_bounds(&meshlet, vertices, faces, face_planes, *meshlet_faces);
+        array_push(*meshlets, meshlet);
+    }
+
+    array_free(vertex_offsets);
+    array_free(vertex_faces);
+    array_free(assigned);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Meshlet files, written by the meshlet tool next to each OBJ file
+///////////////////////////////////////////////////////////////////////////////
+// meshlets <mesh vertices> <mesh faces> <mesh checksum> <number of meshlets>
+// m <faces> <center x y z> <radius> <cone axis x y z> <cone cutoff>
+// f <face index> <face index> ...
+///////////////////////////////////////////////////////////////////////////////
+void get_meshlet_filename(char* obj_filename, char* meshlet_filename, int size) {
+    snprintf(meshlet_filename, size, "%s", obj_filename);
+    char* extension = strrchr(meshlet_filename, '.');
+    if (extension != NULL && strchr(extension, '/') == NULL) {
+        *extension = '\0';
+    }
+    strncat(meshlet_filename, ".meshlets", size - strlen(meshlet_filename) - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// FNV-1a hash of the vertex positions and the face vertex indices, so a mesh
+// exported again with the same counts does not load meshlets of the old one
+///////////////////////////////////////////////////////////////////////////////
+static uint32_t hash_bytes(uint32_t hash, void* data, size_t size) {
+    uint8_t* bytes = (uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t compute_mesh_checksum(vec3_t* vertices, face_t* faces) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < array_length(vertices); i++) {
+        hash = hash_bytes(hash, &vertices[i], sizeof(vec3_t));
+    }
+    for (int i = 0; i < array_length(faces); i++) {
+        int indices[3] = { faces[i].a, faces[i].b, faces[i].c };
+        hash = hash_bytes(hash, indices, sizeof(indices));
+    }
+    return hash;
+}
+
+bool save_meshlets(char* filename, vec3_t* vertices, face_t* faces, meshlet_t* meshlets, int* meshlet_faces) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "meshlets %d %d %08x %d\n", array_length(vertices), array_length(faces), compute_mesh_checksum(vertices, faces), array_length(meshlets));
+    for (int i = 0; i < array_length(meshlets); i++) {
+        meshlet_t* meshlet = &meshlets[i];
+        fprintf(file, "m %d %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\nf",
+            meshlet->num_faces,
+            meshlet->center.x, meshlet->center.y, meshlet->center.z, meshlet->radius,
+            meshlet->cone_axis.x, meshlet->cone_axis.y, meshlet->cone_axis.z, meshlet->cone_cutoff
+        );
+        for (int j = 0; j < meshlet->num_faces; j++) {
+            fprintf(file, " %d", meshlet_faces[meshlet->first_face + j]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    return true;
+}
+
+// Bounding sphere and normal cone of a loaded meshlet have no NaN or infinity
+static bool is_meshlet_finite(meshlet_t* meshlet) {
+    return
+        isfinite(meshlet->center.x) && isfinite(meshlet->center.y) && isfinite(meshlet->center.z) &&
+        isfinite(meshlet->radius) &&
+        isfinite(meshlet->cone_axis.x) && isfinite(meshlet->cone_axis.y) && isfinite(meshlet->cone_axis.z) &&
+        isfinite(meshlet->cone_cutoff);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Load the meshlets of a mesh, returning false if the file is missing or was
+// built for another version of the mesh, so they can be built instead.
+// Every face must belong to exactly one meshlet, and every meshlet must have
+// between 1 and MESHLET_MAX_FACES faces and finite bounds.
+///////////////////////////////////////////////////////////////////////////////
+bool load_meshlets(char* filename, vec3_t* vertices, face_t* faces, meshlet_t** meshlets, int** meshlet_faces) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        return false;
+    }
+    int num_faces = array_length(faces);
+
+    array_reset(*meshlets);
+    array_reset(*meshlet_faces);
+    bool* seen = array_hold(NULL, num_faces, sizeof(bool));
+    memset(seen, 0, num_faces * sizeof(bool));
+
+    int file_num_vertices, file_num_faces, num_meshlets;
+    unsigned int file_checksum;
+    bool valid =
+        fscanf(file, " meshlets %d %d %x %d", &file_num_vertices, &file_num_faces, &file_checksum, &num_meshlets) == 4 &&
+        file_num_vertices == array_length(vertices) && file_num_faces == num_faces &&
+        file_checksum == compute_mesh_checksum(vertices, faces);
+    for (int i = 0; valid && i < num_meshlets; i++) {
+        meshlet_t meshlet = { .first_face = array_length(*meshlet_faces) };
+        valid = fscanf(file, " m %d %f %f %f %f %f %f %f %f f",
+            &meshlet.num_faces,
+            &meshlet.center.x, &meshlet.center.y, &meshlet.center.z, &meshlet.radius,
+            &meshlet.cone_axis.x, &meshlet.cone_axis.y, &meshlet.cone_axis.z, &meshlet.cone_cutoff
+        ) == 9;
+        valid = valid && meshlet.num_faces > 0 && meshlet.num_faces <= MESHLET_MAX_FACES && is_meshlet_finite(&meshlet);
+        for (int j = 0; valid && j < meshlet.num_faces; j++) {
+            int face_index;
+            valid = fscanf(file, "%d", &face_index) == 1 && face_index >= 0 && face_index < num_faces && !seen[face_index];
+            if (valid) {
+                seen[face_index] = true;
+                array_push(*meshlet_faces, face_index);
+            }
+        }
+        array_push(*meshlets, meshlet);
+    }
+    fclose(file);
+    array_free(seen);
+
+    // No face was listed twice, so listing num_faces of them covers every face
+    valid = valid && array_length(*meshlet_faces) == num_faces;
+    if (!valid) {
+        array_reset(*meshlets);
+        array_reset(*meshlet_faces);
+    }
+    return valid;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// True when every face of the meshlet is facing away from a model space camera
+///////////////////////////////////////////////////////////////////////////////
+// A face is culled when dot(normal, vertex - camera) > 0. All normals are
+// inside the cone, and all vertices inside the bounding sphere, so the whole
+// meshlet is culled when the direction from the camera to the sphere is inside
+// the cone mirrored around its apex, with the sphere radius as a margin:
+//     dot(center - camera, axis) >= cutoff * |center - camera| + radius
+///////////////////////////////////////////////////////////////////////////////
+bool is_meshlet_backfacing(meshlet_t* meshlet, vec3_t camera_position, bool flip_winding) {
+    if (meshlet->cone_cutoff >= 1) {
+        return false;
+    }
+    vec3_t direction = vec3_sub(meshlet->center, camera_position);
+    float dot = vec3_dot(direction, meshlet->cone_axis);
+    if (flip_winding) {
+        dot = -dot;
+    }
+    return dot >= meshlet->cone_cutoff * vec3_length(direction) + meshlet->radius;
+}
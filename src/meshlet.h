@@ -0,0 +1,36 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <stdbool.h>
+#include "vector.h"
+#include "triangle.h"
+
+// Meshlets are clusters of up to MESHLET_MAX_FACES adjacent faces
+#define MESHLET_MAX_FACES 128
+
+// Faces up to this far after the first face in file order may join a meshlet without sharing a vertex
+#define MESHLET_WINDOW_FACES 256
+
+// A face only joins a meshlet if its normal is within ~60 degrees of the first face normal
+#define MESHLET_MIN_NORMAL_DOT 0.5
+
+typedef struct {
+    int first_face;     // First entry of the meshlet in the mesh meshlet_faces array
+    int num_faces;      // Number of faces in the meshlet
+    vec3_t center;      // Model space bounding sphere center
+    float radius;       // Model space bounding sphere radius
+    vec3_t cone_axis;   // Average direction of the face normals
+    float cone_cutoff;  // Sine of the normal cone half angle, 1 when the cone is too wide to ever be culled
+} meshlet_t;
+
+void set_meshlet_culling(bool enabled);
+bool should_cull_meshlets(void);
+
+void build_meshlets(vec3_t* vertices, face_t* faces, vec4_t* face_planes, meshlet_t** meshlets, int** meshlet_faces);
+bool load_meshlets(char* filename, vec3_t* vertices, face_t* faces, meshlet_t** meshlets, int** meshlet_faces);
+bool save_meshlets(char* filename, vec3_t* vertices, face_t* faces, meshlet_t* meshlets, int* meshlet_faces);
+void get_meshlet_filename(char* obj_filename, char* meshlet_filename, int size);
+
+bool is_meshlet_backfacing(meshlet_t* meshlet, vec3_t camera_position, bool flip_winding);
+
+#endif
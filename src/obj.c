@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "array.h"
+#include "obj.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Map a whole file into memory read-only, returning NULL on error. Files
+// that can not be mapped (empty files, or no mmap on Windows) are read into
+// a heap buffer instead, and is_mapped tells unmap_file which one it got.
+///////////////////////////////////////////////////////////////////////////////
+static const char* map_file(const char* filename, size_t* size, bool* is_mapped) {
+    *is_mapped = false;
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        void* data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            close(fd);
+            *size = file_stat.st_size;
+            *is_mapped = true;
+            return (const char*)data;
+        }
+    }
+    close(fd);
+#endif
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* data = malloc(file_size > 0 ? file_size : 1);
+    *size = file_size > 0 ? fread(data, 1, file_size, file) : 0;
+    fclose(file);
+    return data;
+}
+
+static void unmap_file(const char* data, size_t size, bool is_mapped) {
+#ifndef _WIN32
+    if (is_mapped) {
+        munmap((void*)data, size);
+        return;
+    }
+#endif
+    free((void*)data);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Hand-written scanners for the tokens of one line, in place of sscanf. Each
+// one skips the blanks in front of its token like the sscanf conversions do,
+// advances the cursor past the token, and returns false if there is none.
+///////////////////////////////////////////////////////////////////////////////
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char* skip_blanks(const char* cursor, const char* end) {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) {
+        cursor++;
+    }
+    return cursor;
+}
+
+static bool scan_int(const char** cursor, const char* end, int* value) {
+    const char* s = skip_blanks(*cursor, end);
+    bool is_negative = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) {
+        s++;
+    }
+    if (s == end || !is_digit(*s)) {
+        return false;
+    }
+    int result = 0;
+    while (s < end && is_digit(*s)) {
+        result = result * 10 + (*s++ - '0');
+    }
+    *value = is_negative ? -result : result;
+    *cursor = s;
+    return true;
+}
+
+// Largest mantissa that converts to a double exactly
+#define MAX_EXACT_MANTISSA (1ULL << 53)
+
+// Powers of ten that are exact doubles
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Scan a decimal float like 0.123456, -12.5, or 1.5e-3. The digits are
+// gathered into an integer mantissa and a power of ten, and with up to 15
+// significant digits and exponents up to 22 both are exact doubles, so the
+// one division rounds correctly before the conversion to float.
+///////////////////////////////////////////////////////////////////////////////
+static bool scan_float(const char** cursor, const char* end, float* value) {
+    const char* s = skip_blanks(*cursor, end);
+    bool is_negative = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) {
+        s++;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int num_digits = 0;
+    while (s < end && is_digit(*s)) {
+        if (mantissa * 10 + 9 <= MAX_EXACT_MANTISSA) {
+            mantissa = mantissa * 10 + (*s - '0');
+        } else {
+            exponent++;
+        }
+        s++;
+        num_digits++;
+    }
+    if (s < end && *s == '.') {
+        s++;
+        while (s < end && is_digit(*s)) {
+            if (mantissa * 10 + 9 <= MAX_EXACT_MANTISSA) {
+                mantissa = mantissa * 10 + (*s - '0');
+                exponent--;
+            }
+            s++;
+            num_digits++;
+        }
+    }
+    if (num_digits == 0) {
+        return false;
+    }
+
+    // Optional exponent, only taken if it has digits
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* exponent_start = s + 1;
+        int exponent_value;
+        if (exponent_start < end && (*exponent_start == '-' || *exponent_start == '+' || is_digit(*exponent_start)) &&
+            scan_int(&exponent_start, end, &exponent_value)) {
+            exponent += exponent_value;
+            s = exponent_start;
+        }
+    }
+
+    double result = (double)mantissa;
+    if (exponent < 0) {
+        result = exponent >= -22 ? result / powers_of_ten[-exponent] : result / pow(10, -exponent);
+    } else if (exponent > 0) {
+        result = exponent <= 22 ? result * powers_of_ten[exponent] : result * pow(10, exponent);
+    }
+    *value = (float)(is_negative ? -result : result);
+    *cursor = s;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Scan one v/vt/vn corner of a face, returning how many of the three indices
+// were read before the first one missing, like the count sscanf returns
+///////////////////////////////////////////////////////////////////////////////
+static int scan_face_corner(const char** cursor, const char* end, int* v, int* vt, int* vn) {
+    if (!scan_int(cursor, end, v)) {
+        return 0;
+    }
+    if (*cursor == end || **cursor != '/') {
+        return 1;
+    }
+    (*cursor)++;
+    if (!scan_int(cursor, end, vt)) {
+        return 1;
+    }
+    if (*cursor == end || **cursor != '/') {
+        return 2;
+    }
+    (*cursor)++;
+    return scan_int(cursor, end, vn) ? 3 : 2;
+}
+
+static int count_tokens(const char* cursor, const char* end) {
+    int num_tokens = 0;
+    while ((cursor = skip_blanks(cursor, end)) < end) {
+        num_tokens++;
+        while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\r') {
+            cursor++;
+        }
+    }
+    return num_tokens;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Turn a 1-based OBJ index into a positive one among the num_elements read
+// so far, where -1 is the last one, returning 0 if it is out of range
+///////////////////////////////////////////////////////////////////////////////
+static int resolve_index(int index, int num_elements) {
+    if (index < 0) {
+        index += num_elements + 1;
+    }
+    return index >= 1 && index <= num_elements ? index : 0;
+}
+
+static const char* find_line_end(const char* cursor, const char* end) {
+    const char* line_end = memchr(cursor, '\n', end - cursor);
+    return line_end != NULL ? line_end : end;
+}
+
+static const char* next_line(const char* line_end, const char* end) {
+    return line_end < end ? line_end + 1 : end;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Load the vertices and the triangle faces of an OBJ file
+///////////////////////////////////////////////////////////////////////////////
+// The file is mapped into memory and read in two passes. The first one only
+// finds the "v", "vt", and "f" lines and counts them, so the arrays are
+// allocated once at their final size. The second one scans the numbers of
+// each line in place. Faces are read in the v/vt/vn format, and quads are
+// split into the two triangles [0,1,2] and [0,2,3]. Faces with an index out
+// of range are skipped. Returns false if the file can not be read.
+///////////////////////////////////////////////////////////////////////////////
+bool load_obj_file(const char* filename, vec3_t** vertices, face_t** faces) {
+    size_t size;
+    bool is_mapped;
+    const char* data = map_file(filename, &size, &is_mapped);
+    if (data == NULL) {
+        return false;
+    }
+    const char* end = data + size;
+
+    // Counting pass
+    int num_vertices = 0;
+    int num_texcoords = 0;
+    int num_faces = 0;
+    for (const char* line = data, *line_end; line < end; line = next_line(line_end, end)) {
+        line_end = find_line_end(line, end);
+        if (line_end - line >= 2 && line[0] == 'v' && line[1] == ' ') {
+            num_vertices++;
+        } else if (line_end - line >= 3 && line[0] == 'v' && line[1] == 't' && line[2] == ' ') {
+            num_texcoords++;
+        } else if (line_end - line >= 2 && line[0] == 'f' && line[1] == ' ') {
+            num_faces += count_tokens(line + 2, line_end) >= 4 ? 2 : 1;
+        }
+    }
+
+    // Reserve the arrays at their final size, and leave them empty to be filled with array_push
+    *vertices = array_hold(*vertices, num_vertices, sizeof(vec3_t));
+    *faces = array_hold(*faces, num_faces, sizeof(face_t));
+    tex2_t* texcoords = array_hold(NULL, num_texcoords, sizeof(tex2_t));
+    array_reset(*vertices);
+    array_reset(*faces);
+    array_reset(texcoords);
+
+    // Parsing pass
+    for (const char* line = data, *line_end; line < end; line = next_line(line_end, end)) {
+        line_end = find_line_end(line, end);
+        const char* cursor = line + 2;
+
+        // Vertex information, missing coordinates are left at zero so the vertex numbering stays in step
+        if (line_end - line >= 2 && line[0] == 'v' && line[1] == ' ') {
+            vec3_t vertex = { 0, 0, 0 };
+            if (scan_float(&cursor, line_end, &vertex.x) && scan_float(&cursor, line_end, &vertex.y)) {
+                scan_float(&cursor, line_end, &vertex.z);
+            }
+            array_push(*vertices, vertex);
+        }
+        // Texture coordinate information
+        else if (line_end - line >= 3 && line[0] == 'v' && line[1] == 't' && line[2] == ' ') {
+            tex2_t texcoord = { 0, 0 };
+            cursor = line + 3;
+            if (scan_float(&cursor, line_end, &texcoord.u)) {
+                scan_float(&cursor, line_end, &texcoord.v);
+            }
+            array_push(texcoords, texcoord);
+        }
+        // Face information
+        else if (line_end - line >= 2 && line[0] == 'f' && line[1] == ' ') {
+            int v[4], vt[4], vn[4];
+            int count = 0;
+            for (int i = 0; i < 4; i++) {
+                int num_indices = scan_face_corner(&cursor, line_end, &v[i], &vt[i], &vn[i]);
+                count += num_indices;
+                if (num_indices < 3) {
+                    break;
+                }
+            }
+
+            // Negative indices count back from the last vertex or texture coordinate read so far, and
+            // faces that reference ones that were not defined before them are skipped
+            bool has_valid_indices = true;
+            for (int i = 0; i < count / 3; i++) {
+                v[i] = resolve_index(v[i], array_length(*vertices));
+                vt[i] = resolve_index(vt[i], array_length(texcoords));
+                has_valid_indices = has_valid_indices && v[i] != 0 && vt[i] != 0;
+            }
+
+            if (count == 9 && has_valid_indices) {
+                // Triangle
+                face_t face = {
+                    .a = v[0],
+                    .b = v[1],
+                    .c = v[2],
+                    .a_uv = texcoords[vt[0] - 1],
+                    .b_uv = texcoords[vt[1] - 1],
+                    .c_uv = texcoords[vt[2] - 1],
+                    .color = 0xFFFFFFFF
+                };
+                array_push(*faces, face);
+            } else if (count == 12 && has_valid_indices) {
+                // Quad split into two triangles: [0,1,2] and [0,2,3]
+                face_t face1 = {
+                    .a = v[0],
+                    .b = v[1],
+                    .c = v[2],
+                    .a_uv = texcoords[vt[0] - 1],
+                    .b_uv = texcoords[vt[1] - 1],
+                    .c_uv = texcoords[vt[2] - 1],
+                    .color = 0xFFFFFFFF
+                };
+                face_t face2 = {
+                    .a = v[0],
+                    .b = v[2],
+                    .c = v[3],
+                    .a_uv = texcoords[vt[0] - 1],
+                    .b_uv = texcoords[vt[2] - 1],
+                    .c_uv = texcoords[vt[3] - 1],
+                    .color = 0xFFFFFFFF
+                };
+                array_push(*faces, face1);
+                array_push(*faces, face2);
+            }
+        }
+    }
+
+    array_free(texcoords);
+    unmap_file(data, size, is_mapped);
+    return true;
+}
@@ -0,0 +1,10 @@
+#ifndef OBJ_H
+#define OBJ_H
+
+#include <stdbool.h>
+#include "triangle.h"
+#include "vector.h"
+
+bool load_obj_file(const char* filename, vec3_t** vertices, face_t** faces);
+
+#endif
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include "mesh.h"
+#include "scene.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Scenes that can be selected by name from the command line
+///////////////////////////////////////////////////////////////////////////////
+static const scene_t scenes[] = {
+    {
+        .name = "f22",
+        .num_meshes = 1,
+        .meshes = {
+            { "./assets/f22.obj", "./assets/f22.png", { 1, 1, 1 }, { 0, 0, +5 }, { 0, 0, 0 } }
+        }
+    },
+    {
+        .name = "airfield",
+        .num_meshes = 4,
+        .meshes = {
+            { "./assets/runway.obj", "./assets/runway.png", { 1, 1, 1 }, { 0, -1.5, +23 }, { 0, 0, 0 } },
+            { "./assets/f22.obj", "./assets/f22.png", { 1, 1, 1 }, { 0, -1.3, +5 }, { 0, -M_PI / 2, 0 } },
+            { "./assets/efa.obj", "./assets/efa.png", { 1, 1, 1 }, { -2, -1.3, +9 }, { 0, -M_PI / 2, 0 } },
+            { "./assets/f117.obj", "./assets/f117.png", { 1, 1, 1 }, { +2, -1.3, +9 }, { 0, -M_PI / 2, 0 } }
+        }
+    }
+};
+
+static bool file_exists(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    fclose(file);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Load the meshes of a scene from the table above, or a single textured
+// mesh ./assets/<name>.obj with ./assets/<name>.png in front of the camera.
+// Returns false if there is no such scene.
+///////////////////////////////////////////////////////////////////////////////
+bool load_scene(const char* name) {
+    int num_scenes = sizeof(scenes) / sizeof(scenes[0]);
+    for (int i = 0; i < num_scenes; i++) {
+        if (strcmp(scenes[i].name, name) == 0) {
+            for (int j = 0; j < scenes[i].num_meshes; j++) {
+                const scene_mesh_t* mesh = &scenes[i].meshes[j];
+                load_mesh(mesh->obj_filename, mesh->png_filename, mesh->scale, mesh->translation, mesh->rotation);
+            }
+            return true;
+        }
+    }
+
+    char obj_filename[1024];
+    char png_filename[1024];
+    snprintf(obj_filename, sizeof(obj_filename), "./assets/%s.obj", name);
+    snprintf(png_filename, sizeof(png_filename), "./assets/%s.png", name);
+    if (!file_exists(obj_filename) || !file_exists(png_filename)) {
+        return false;
+    }
+    load_mesh(obj_filename, png_filename, vec3_new(1, 1, 1), vec3_new(0, 0, +5), vec3_new(0, 0, 0));
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Average position of the scene meshes, the point camera paths look at
+///////////////////////////////////////////////////////////////////////////////
+vec3_t get_scene_center(void) {
+    vec3_t center = vec3_new(0, 0, 0);
+    int num_meshes = get_num_meshes();
+    for (int i = 0; i < num_meshes; i++) {
+        center = vec3_add(center, get_mesh(i)->translation);
+    }
+    return num_meshes > 0 ? vec3_div(center, num_meshes) : center;
+}
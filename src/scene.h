@@ -0,0 +1,26 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <stdbool.h>
+#include "vector.h"
+
+#define MAX_SCENE_MESHES 8
+
+typedef struct {
+    char* obj_filename;
+    char* png_filename;
+    vec3_t scale;
+    vec3_t translation;
+    vec3_t rotation;
+} scene_mesh_t;
+
+typedef struct {
+    char* name;
+    int num_meshes;
+    scene_mesh_t meshes[MAX_SCENE_MESHES];
+} scene_t;
+
+bool load_scene(const char* name);
+vec3_t get_scene_center(void);
+
+#endif
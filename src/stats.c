@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+#include "threadpool.h"
+
+#define CACHE_LINE_SIZE 64
+
+///////////////////////////////////////////////////////////////////////////////
+// One stats block per thread of the pool, padded to whole cache lines so the
+// threads never write to the same line
+///////////////////////////////////////////////////////////////////////////////
+typedef union {
+    stats_t stats;
+    char padding[(sizeof(stats_t) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE];
+} stats_slot_t;
+
+static stats_slot_t thread_stats[MAX_NUM_THREADS] __attribute__((aligned(CACHE_LINE_SIZE)));
+
+stats_t* get_thread_stats(int thread_index) {
+    return &thread_stats[thread_index].stats;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Stats block of the calling thread, for code that is not handed the thread
+// index by its job function
+///////////////////////////////////////////////////////////////////////////////
+stats_t* get_current_thread_stats(void) {
+    return &thread_stats[get_current_thread_index()].stats;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Zero the counters of all threads at the start of a frame, while the
+// workers are idle
+///////////////////////////////////////////////////////////////////////////////
+void reset_stats(void) {
+    memset(thread_stats, 0, sizeof(thread_stats));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Value of a counter summed over all threads, since the last reset
+///////////////////////////////////////////////////////////////////////////////
+int get_stat(int counter) {
+    int total = 0;
+    for (int i = 0; i < MAX_NUM_THREADS; i++) {
+        total += thread_stats[i].stats.counters[counter];
+    }
+    return total;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Log the counters of the last frame, one line per pipeline stage
+///////////////////////////////////////////////////////////////////////////////
+void print_stats(void) {
+#if RENDER_STATS
+    int faces_visited = get_stat(STAT_FACES_VISITED);
+    int vertices_transformed = get_stat(STAT_VERTICES_TRANSFORMED);
+    printf("Meshes: %d outside, %d inside, %d intersecting the frustum\n",
+        get_stat(STAT_MESHES_OUTSIDE), get_stat(STAT_MESHES_INSIDE), get_stat(STAT_MESHES_INTERSECTING));
+    printf("Meshlets: %d visited, %d cone culled, %d frustum culled\n",
+        get_stat(STAT_MESHLETS_VISITED), get_stat(STAT_MESHLETS_CONE_CULLED), get_stat(STAT_MESHLETS_FRUSTUM_CULLED));
+    printf("Vertices: %d of %d transformed (%.2f per face)\n",
+        vertices_transformed, get_stat(STAT_VERTICES_TOTAL), faces_visited > 0 ? (float)vertices_transformed / faces_visited : 0);
+    printf("Faces: %d visited, %d backface culled, %d frustum rejected, %d accepted, %d clipped (%d plane passes)\n",
+        faces_visited, get_stat(STAT_FACES_BACKFACE_CULLED), get_stat(STAT_FACES_FRUSTUM_REJECTED),
+        get_stat(STAT_FACES_ACCEPTED), get_stat(STAT_FACES_CLIPPED), get_stat(STAT_CLIP_PLANE_PASSES));
+    printf("Triangles: %d emitted, %d Hi-Z culled in a tile\n",
+        get_stat(STAT_TRIANGLES_EMITTED), get_stat(STAT_TRIANGLES_HIZ_CULLED));
+    printf("Pixels: %d Hi-Z culled, %d tested, %d depth rejected, %d written\n",
+        get_stat(STAT_PIXELS_HIZ_CULLED), get_stat(STAT_PIXELS_TESTED), get_stat(STAT_PIXELS_DEPTH_REJECTED), get_stat(STAT_PIXELS_WRITTEN));
+
+    // Depth complexity of the pixels that were drawn, only counted by the overdraw heatmap
+    int pixels_covered = get_stat(STAT_PIXELS_COVERED);
+    if (pixels_covered > 0) {
+        printf("Overdraw: %d pixels covered, %.2f depth tests and %.2f passes per pixel, %d pixels written more than once\n",
+            pixels_covered, (float)get_stat(STAT_PIXELS_TESTED) / pixels_covered, (float)get_stat(STAT_PIXELS_WRITTEN) / pixels_covered,
+            get_stat(STAT_PIXELS_OVERDRAWN));
+    }
+#endif
+}
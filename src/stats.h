@@ -0,0 +1,59 @@
+#ifndef STATS_H
+#define STATS_H
+
+// Build with -DRENDER_STATS=0 to compile all counting out of the pipeline
+#ifndef RENDER_STATS
+#define RENDER_STATS 1
+#endif
+
+enum stat_counter {
+    STAT_MESHES_OUTSIDE,           // Meshes skipped because their bounds are outside the frustum
+    STAT_MESHES_INSIDE,            // Meshes drawn without clipping
+    STAT_MESHES_INTERSECTING,      // Meshes clipped face by face
+    STAT_MESHLETS_VISITED,
+    STAT_MESHLETS_CONE_CULLED,     // Meshlets with all their faces looking away from the camera
+    STAT_MESHLETS_FRUSTUM_CULLED,  // Meshlets with their bounding sphere outside the frustum
+    STAT_VERTICES_TOTAL,           // Vertices of the meshes that were not skipped
+    STAT_VERTICES_TRANSFORMED,     // Vertices referenced by a front face, transformed once each
+    STAT_FACES_VISITED,            // Faces of the meshes that were not skipped
+    STAT_FACES_BACKFACE_CULLED,    // Faces culled in model space, alone or with their meshlet
+    STAT_FACES_FRUSTUM_REJECTED,   // Faces outside a frustum plane, alone or with their meshlet
+    STAT_FACES_ACCEPTED,           // Faces inside all planes, not clipped
+    STAT_FACES_CLIPPED,            // Faces clipped against the planes they straddle
+    STAT_CLIP_PLANE_PASSES,        // Plane passes run for the clipped faces
+    STAT_TRIANGLES_EMITTED,        // Triangles projected and handed to the rasterizer
+    STAT_TRIANGLES_HIZ_CULLED,     // Triangles with all their blocks of a tile rejected by the Hi-Z buffer
+    STAT_PIXELS_HIZ_CULLED,        // Candidate pixels inside the blocks rejected by the Hi-Z buffer
+    STAT_PIXELS_TESTED,            // Pixels inside a triangle that ran the depth test in a color pass
+    STAT_PIXELS_DEPTH_REJECTED,    // Tested pixels that failed the depth test
+    STAT_PIXELS_WRITTEN,           // Tested pixels that wrote their color
+    STAT_PIXELS_COVERED,           // Pixels with at least one depth test, counted by RENDER_OVERDRAW
+    STAT_PIXELS_OVERDRAWN,         // Covered pixels that passed the depth test more than once
+    NUM_STAT_COUNTERS
+};
+
+typedef struct {
+    int counters[NUM_STAT_COUNTERS];
+} stats_t;
+
+///////////////////////////////////////////////////////////////////////////////
+// Every thread adds to its own stats block, so counting needs no atomics.
+// Hot loops tally into locals with STAT_COUNT and add them once per
+// triangle or job with STAT_ADD.
+///////////////////////////////////////////////////////////////////////////////
+#if RENDER_STATS
+#define STAT_ADD(stats, counter, value) ((stats)->counters[(counter)] += (value))
+#define STAT_COUNT(tally, value) ((tally) += (value))
+#else
+#define STAT_ADD(stats, counter, value) ((void)(stats))
+#define STAT_COUNT(tally, value) ((void)(tally))
+#endif
+
+stats_t* get_thread_stats(int thread_index);
+stats_t* get_current_thread_stats(void);
+void reset_stats(void);
+
+int get_stat(int counter);
+void print_stats(void);
+
+#endif
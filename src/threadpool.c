@@ -0,0 +1,121 @@
+#include <stdbool.h>
+#include <SDL.h>
+#include "threadpool.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Pool of worker threads that pull job indices from a shared atomic counter.
+// The calling thread works as thread 0, so a pool of N threads creates N-1
+// SDL worker threads.
+///////////////////////////////////////////////////////////////////////////////
+static SDL_Thread* workers[MAX_NUM_THREADS];
+static int num_threads = 1;
+
+static SDL_sem* start_semaphore = NULL;
+static SDL_sem* done_semaphore = NULL;
+static bool is_shutting_down = false;
+
+static job_function_t current_job = NULL;
+static void* current_data = NULL;
+static int current_num_jobs = 0;
+static SDL_atomic_t next_job_index;
+
+// Thread local index of each worker thread, unset (0) on the calling thread
+static SDL_TLSID thread_index_key = 0;
+
+static void run_pending_jobs(int thread_index) {
+    int job_index;
+    while ((job_index = SDL_AtomicAdd(&next_job_index, 1)) < current_num_jobs) {
+        current_job(current_data, job_index, thread_index);
+    }
+}
+
+static int worker_main(void* data) {
+    int thread_index = (int)(intptr_t)data;
+    SDL_TLSSet(thread_index_key, data, NULL);
+    while (true) {
+        SDL_SemWait(start_semaphore);
+        if (is_shutting_down) {
+            break;
+        }
+        run_pending_jobs(thread_index);
+        SDL_SemPost(done_semaphore);
+    }
+    return 0;
+}
+
+void init_thread_pool(int requested_threads) {
+    if (requested_threads <= 0) {
+        requested_threads = SDL_GetCPUCount();
+    }
+    if (requested_threads > MAX_NUM_THREADS) {
+        requested_threads = MAX_NUM_THREADS;
+    }
+
+    if (thread_index_key == 0) {
+        thread_index_key = SDL_TLSCreate();
+    }
+    start_semaphore = SDL_CreateSemaphore(0);
+    done_semaphore = SDL_CreateSemaphore(0);
+    is_shutting_down = false;
+
+    num_threads = 1;
+    for (int i = 1; i < requested_threads; i++) {
+        workers[i] = SDL_CreateThread(worker_main, "worker", (void*)(intptr_t)i);
+        if (!workers[i]) {
+            fprintf(stderr, "Error creating worker thread: %s\n", SDL_GetError());
+            break;
+        }
+        num_threads++;
+    }
+}
+
+int get_thread_pool_size(void) {
+    return num_threads;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Index of the calling thread in the pool, the same index its jobs receive
+///////////////////////////////////////////////////////////////////////////////
+int get_current_thread_index(void) {
+    return thread_index_key != 0 ? (int)(intptr_t)SDL_TLSGet(thread_index_key) : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Run job(data, job_index, thread_index) for every job index in [0, num_jobs)
+// and return once all of them are finished
+///////////////////////////////////////////////////////////////////////////////
+void run_parallel_jobs(job_function_t job, void* data, int num_jobs) {
+    // Small batches are not worth waking up the workers
+    if (num_threads == 1 || num_jobs <= 1) {
+        for (int i = 0; i < num_jobs; i++) {
+            job(data, i, 0);
+        }
+        return;
+    }
+
+    current_job = job;
+    current_data = data;
+    current_num_jobs = num_jobs;
+    SDL_AtomicSet(&next_job_index, 0);
+
+    for (int i = 1; i < num_threads; i++) {
+        SDL_SemPost(start_semaphore);
+    }
+    run_pending_jobs(0);
+    for (int i = 1; i < num_threads; i++) {
+        SDL_SemWait(done_semaphore);
+    }
+}
+
+void destroy_thread_pool(void) {
+    is_shutting_down = true;
+    for (int i = 1; i < num_threads; i++) {
+        SDL_SemPost(start_semaphore);
+    }
+    for (int i = 1; i < num_threads; i++) {
+        SDL_WaitThread(workers[i], NULL);
+    }
+    SDL_DestroySemaphore(start_semaphore);
+    SDL_DestroySemaphore(done_semaphore);
+    num_threads = 1;
+}
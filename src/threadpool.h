@@ -0,0 +1,14 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#define MAX_NUM_THREADS 64
+
+typedef void (*job_function_t)(void* data, int job_index, int thread_index);
+
+void init_thread_pool(int num_threads);
+int get_thread_pool_size(void);
+int get_current_thread_index(void);
+void run_parallel_jobs(job_function_t job, void* data, int num_jobs);
+void destroy_thread_pool(void);
+
+#endif
@@ -0,0 +1,93 @@
+#include <math.h>
+#include "array.h"
+#include "tiles.h"
+
+static tile_t* tiles = NULL;
+static int num_tiles_x = 0;
+static int num_tiles_y = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+// Split the screen into a grid of TILE_SIZE x TILE_SIZE tiles
+///////////////////////////////////////////////////////////////////////////////
+//
+//  +------+------+------+--+
+//  |  0   |  1   |  2   |3 |
+//  +------+------+------+--+
+//  |  4   |  5   |  6   |7 |   <-- tiles on the right and bottom borders
+//  +------+------+------+--+       are clamped to the screen size
+//
+///////////////////////////////////////////////////////////////////////////////
+void init_tiles(int width, int height) {
+    num_tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    num_tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    for (int ty = 0; ty < num_tiles_y; ty++) {
+        for (int tx = 0; tx < num_tiles_x; tx++) {
+            tile_t tile = {
+                .rect = {
+                    .x_min = tx * TILE_SIZE,
+                    .y_min = ty * TILE_SIZE,
+                    .x_max = MIN((tx + 1) * TILE_SIZE, width) - 1,
+                    .y_max = MIN((ty + 1) * TILE_SIZE, height) - 1
+                },
+                .triangles = NULL
+            };
+            array_push(tiles, tile);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Add the index of every triangle to all the tiles touched by its bounding box,
+// keeping the triangles of each tile in submission order
+///////////////////////////////////////////////////////////////////////////////
+void bin_triangles(screen_triangle_t* triangles, int num_triangles) {
+    for (int i = 0; i < get_num_tiles(); i++) {
+        array_reset(tiles[i].triangles);
+    }
+
+    int screen_x_max = num_tiles_x * TILE_SIZE - 1;
+    int screen_y_max = num_tiles_y * TILE_SIZE - 1;
+
+    for (int i = 0; i < num_triangles; i++) {
+        screen_point_t* p = triangles[i].points;
+
+        // Find the triangle bounding box the same way the rasterizers do
+        int x_min = floor(MIN(MIN(p[0].x, p[1].x), p[2].x));
+        int y_min = floor(MIN(MIN(p[0].y, p[1].y), p[2].y));
+        int x_max = ceil(MAX(MAX(p[0].x, p[1].x), p[2].x));
+        int y_max = ceil(MAX(MAX(p[0].y, p[1].y), p[2].y));
+
+        // Skip triangles that are completely outside the screen
+        if (x_max < 0 || y_max < 0 || x_min > screen_x_max || y_min > screen_y_max) {
+            continue;
+        }
+
+        int tx_min = MAX(x_min, 0) / TILE_SIZE;
+        int ty_min = MAX(y_min, 0) / TILE_SIZE;
+        int tx_max = MIN(x_max, screen_x_max) / TILE_SIZE;
+        int ty_max = MIN(y_max, screen_y_max) / TILE_SIZE;
+
+        for (int ty = ty_min; ty <= ty_max; ty++) {
+            for (int tx = tx_min; tx <= tx_max; tx++) {
+                array_push(tiles[ty * num_tiles_x + tx].triangles, i);
+            }
+        }
+    }
+}
+
+int get_num_tiles(void) {
+    return array_length(tiles);
+}
+
+tile_t* get_tile(int tile_index) {
+    return &tiles[tile_index];
+}
+
+void free_tiles(void) {
+    for (int i = 0; i < get_num_tiles(); i++) {
+        array_free(tiles[i].triangles);
+    }
+    array_free(tiles);
+    tiles = NULL;
+}
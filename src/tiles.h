@@ -0,0 +1,22 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include "display.h"
+#include "triangle.h"
+
+#define TILE_SIZE 64
+
+typedef struct {
+    rect_t rect;              // screen pixels owned by the tile
+    int* triangles;           // dynamic array of indices of the triangles overlapping the tile
+} tile_t;
+
+void init_tiles(int width, int height);
+void bin_triangles(screen_triangle_t* triangles, int num_triangles);
+
+int get_num_tiles(void);
+tile_t* get_tile(int tile_index);
+
+void free_tiles(void);
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <SDL.h>
+#include "threadpool.h"
+#include "trace.h"
+
+typedef struct {
+    const char* name;   // Static string, the zones only keep the pointer
+    uint64_t start;     // Performance counter at the start and end of the zone
+    uint64_t end;
+    int thread_index;
+    int arg;            // Mesh, job, or tile index, or TRACE_NO_ARG
+} trace_zone_t;
+
+///////////////////////////////////////////////////////////////////////////////
+// Ring buffer of the most recent zones. Every thread claims the next slot
+// with an atomic increment and fills it in, so recording never takes a lock,
+// and the oldest zones are overwritten once the buffer is full.
+///////////////////////////////////////////////////////////////////////////////
+static trace_zone_t zones[TRACE_BUFFER_SIZE];
+static SDL_atomic_t num_zones;
+
+uint64_t get_trace_time(void) {
+    return SDL_GetPerformanceCounter();
+}
+
+void add_trace_zone(const char* name, int arg, uint64_t start_time) {
+    uint64_t end_time = SDL_GetPerformanceCounter();
+    unsigned int index = (unsigned int)SDL_AtomicAdd(&num_zones, 1) & (TRACE_BUFFER_SIZE - 1);
+    zones[index].name = name;
+    zones[index].start = start_time;
+    zones[index].end = end_time;
+    zones[index].thread_index = get_current_thread_index();
+    zones[index].arg = arg;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Write the zones in the ring buffer as Chrome trace events, which Perfetto
+// and chrome://tracing open as one timeline track per thread:
+//
+// { "traceEvents": [
+//   { "name": "update", "ph": "X", "ts": 1234.567, "dur": 2.345, "pid": 1, "tid": 0 },
+//   ...
+// ], "displayTimeUnit": "ms" }
+//
+// Times are in microseconds from the oldest zone. Call it from the main
+// thread between frames, when no other thread is recording zones.
+///////////////////////////////////////////////////////////////////////////////
+bool write_trace_json(const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    unsigned int total_zones = (unsigned int)SDL_AtomicGet(&num_zones);
+    unsigned int count = total_zones < TRACE_BUFFER_SIZE ? total_zones : TRACE_BUFFER_SIZE;
+    unsigned int first = total_zones - count;
+
+    uint64_t origin = count > 0 ? zones[first & (TRACE_BUFFER_SIZE - 1)].start : 0;
+    for (unsigned int i = 0; i < count; i++) {
+        trace_zone_t* zone = &zones[(first + i) & (TRACE_BUFFER_SIZE - 1)];
+        origin = zone->start < origin ? zone->start : origin;
+    }
+    double microseconds_per_tick = 1e6 / SDL_GetPerformanceFrequency();
+
+    fprintf(file, "{ \"traceEvents\": [");
+
+    // Name the thread tracks, the main thread is also thread 0 of the pool
+    const char* separator = "\n";
+    for (int i = 0; i < get_thread_pool_size(); i++) {
+        fprintf(file, "%s  { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": { \"name\": \"%s %d\" } }",
+            separator, i, i == 0 ? "main" : "worker", i);
+        separator = ",\n";
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        trace_zone_t* zone = &zones[(first + i) & (TRACE_BUFFER_SIZE - 1)];
+        fprintf(file, "%s  { \"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d",
+            separator,
+            zone->name,
+            (zone->start - origin) * microseconds_per_tick,
+            (zone->end - zone->start) * microseconds_per_tick,
+            zone->thread_index
+        );
+        if (zone->arg != TRACE_NO_ARG) {
+            fprintf(file, ", \"args\": { \"index\": %d }", zone->arg);
+        }
+        fprintf(file, " }");
+    }
+
+    fprintf(file, "\n], \"displayTimeUnit\": \"ms\" }\n");
+    return fclose(file) == 0;
+}
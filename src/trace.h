@@ -0,0 +1,41 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Build with -DRENDER_TRACE=0 to compile all zones out of the renderer
+#ifndef RENDER_TRACE
+#define RENDER_TRACE 1
+#endif
+
+// Number of zones kept in the ring buffer, a power of two, enough for the last few hundred frames
+#define TRACE_BUFFER_SIZE (1 << 16)
+
+// File written when the trace is dumped with the T key
+#define TRACE_DEFAULT_FILENAME "trace.json"
+
+// Zone arguments that are not an index
+#define TRACE_NO_ARG -1
+
+///////////////////////////////////////////////////////////////////////////////
+// A zone is timed from TRACE_BEGIN to TRACE_END in the same scope, and is
+// recorded with the index of the calling thread:
+//
+//   TRACE_BEGIN(update_zone);
+//   ...
+//   TRACE_END(update_zone, "update", TRACE_NO_ARG);
+///////////////////////////////////////////////////////////////////////////////
+#if RENDER_TRACE
+#define TRACE_BEGIN(zone) uint64_t zone = get_trace_time()
+#define TRACE_END(zone, name, arg) add_trace_zone((name), (arg), (zone))
+#else
+#define TRACE_BEGIN(zone) ((void)0)
+#define TRACE_END(zone, name, arg) ((void)0)
+#endif
+
+uint64_t get_trace_time(void);
+void add_trace_zone(const char* name, int arg, uint64_t start_time);
+bool write_trace_json(const char* filename);
+
+#endif
@@ -0,0 +1,224 @@
+#include <stdbool.h>
+#include "transform.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TRANSFORM_X86_KERNELS
+#endif
+
+static int transform_kernel = TRANSFORM_KERNEL_SCALAR;
+
+///////////////////////////////////////////////////////////////////////////////
+// Scalar kernel, one vertex at a time (also used for the tail of SIMD batches)
+///////////////////////////////////////////////////////////////////////////////
+static void transform_vertices_scalar(mat4_t* m, float* xs, float* ys, float* zs, vec4_t* out, int count) {
+    for (int i = 0; i < count; i++) {
+        out[i].x = m->m[0][0] * xs[i] + m->m[0][1] * ys[i] + m->m[0][2] * zs[i] + m->m[0][3];
+        out[i].y = m->m[1][0] * xs[i] + m->m[1][1] * ys[i] + m->m[1][2] * zs[i] + m->m[1][3];
+        out[i].z = m->m[2][0] * xs[i] + m->m[2][1] * ys[i] + m->m[2][2] * zs[i] + m->m[2][3];
+        out[i].w = m->m[3][0] * xs[i] + m->m[3][1] * ys[i] + m->m[3][2] * zs[i] + m->m[3][3];
+    }
+}
+
+static void transform_vertices_indexed_scalar(mat4_t* m, float* xs, float* ys, float* zs, int* indices, vec4_t* out, int count) {
+    for (int i = 0; i < count; i++) {
+        int j = indices[i];
+        out[j].x = m->m[0][0] * xs[j] + m->m[0][1] * ys[j] + m->m[0][2] * zs[j] + m->m[0][3];
+        out[j].y = m->m[1][0] * xs[j] + m->m[1][1] * ys[j] + m->m[1][2] * zs[j] + m->m[1][3];
+        out[j].z = m->m[2][0] * xs[j] + m->m[2][1] * ys[j] + m->m[2][2] * zs[j] + m->m[2][3];
+        out[j].w = m->m[3][0] * xs[j] + m->m[3][1] * ys[j] + m->m[3][2] * zs[j] + m->m[3][3];
+    }
+}
+
+#ifdef TRANSFORM_X86_KERNELS
+
+///////////////////////////////////////////////////////////////////////////////
+// SSE kernel, 4 vertices per instruction
+///////////////////////////////////////////////////////////////////////////////
+// The products are summed in the same order as the scalar kernel, so all
+// kernels produce bit-identical results.
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("sse2")))
+static void transform_vertices_sse(mat4_t* m, float* xs, float* ys, float* zs, vec4_t* out, int count) {
+    __m128 m00 = _mm_set1_ps(m->m[0][0]), m01 = _mm_set1_ps(m->m[0][1]), m02 = _mm_set1_ps(m->m[0][2]), m03 = _mm_set1_ps(m->m[0][3]);
+    __m128 m10 = _mm_set1_ps(m->m[1][0]), m11 = _mm_set1_ps(m->m[1][1]), m12 = _mm_set1_ps(m->m[1][2]), m13 = _mm_set1_ps(m->m[1][3]);
+    __m128 m20 = _mm_set1_ps(m->m[2][0]), m21 = _mm_set1_ps(m->m[2][1]), m22 = _mm_set1_ps(m->m[2][2]), m23 = _mm_set1_ps(m->m[2][3]);
+    __m128 m30 = _mm_set1_ps(m->m[3][0]), m31 = _mm_set1_ps(m->m[3][1]), m32 = _mm_set1_ps(m->m[3][2]), m33 = _mm_set1_ps(m->m[3][3]);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(&xs[i]);
+        __m128 y = _mm_loadu_ps(&ys[i]);
+        __m128 z = _mm_loadu_ps(&zs[i]);
+
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m01, y)), _mm_mul_ps(m02, z)), m03);
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, x), _mm_mul_ps(m11, y)), _mm_mul_ps(m12, z)), m13);
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, x), _mm_mul_ps(m21, y)), _mm_mul_ps(m22, z)), m23);
+        __m128 rw = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m30, x), _mm_mul_ps(m31, y)), _mm_mul_ps(m32, z)), m33);
+
+        // Transpose the x, y, z, w lanes back into four vec4_t vertices
+        _MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+        _mm_storeu_ps(&out[i + 0].x, rx);
+        _mm_storeu_ps(&out[i + 1].x, ry);
+        _mm_storeu_ps(&out[i + 2].x, rz);
+        _mm_storeu_ps(&out[i + 3].x, rw);
+    }
+    transform_vertices_scalar(m, xs + i, ys + i, zs + i, out + i, count - i);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 kernel, 8 vertices per instruction
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2")))
+static void transform_vertices_avx2(mat4_t* m, float* xs, float* ys, float* zs, vec4_t* out, int count) {
+    __m256 m00 = _mm256_set1_ps(m->m[0][0]), m01 = _mm256_set1_ps(m->m[0][1]), m02 = _mm256_set1_ps(m->m[0][2]), m03 = _mm256_set1_ps(m->m[0][3]);
+    __m256 m10 = _mm256_set1_ps(m->m[1][0]), m11 = _mm256_set1_ps(m->m[1][1]), m12 = _mm256_set1_ps(m->m[1][2]), m13 = _mm256_set1_ps(m->m[1][3]);
+    __m256 m20 = _mm256_set1_ps(m->m[2][0]), m21 = _mm256_set1_ps(m->m[2][1]), m22 = _mm256_set1_ps(m->m[2][2]), m23 = _mm256_set1_ps(m->m[2][3]);
+    __m256 m30 = _mm256_set1_ps(m->m[3][0]), m31 = _mm256_set1_ps(m->m[3][1]), m32 = _mm256_set1_ps(m->m[3][2]), m33 = _mm256_set1_ps(m->m[3][3]);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(&xs[i]);
+        __m256 y = _mm256_loadu_ps(&ys[i]);
+        __m256 z = _mm256_loadu_ps(&zs[i]);
+
+        __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, x), _mm256_mul_ps(m01, y)), _mm256_mul_ps(m02, z)), m03);
+        __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m10, x), _mm256_mul_ps(m11, y)), _mm256_mul_ps(m12, z)), m13);
+        __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m20, x), _mm256_mul_ps(m21, y)), _mm256_mul_ps(m22, z)), m23);
+        __m256 rw = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m30, x), _mm256_mul_ps(m31, y)), _mm256_mul_ps(m32, z)), m33);
+
+        // Transpose the x, y, z, w lanes back into eight vec4_t vertices
+        __m256 t0 = _mm256_unpacklo_ps(rx, ry); // x0 y0 x1 y1 | x4 y4 x5 y5
+        __m256 t1 = _mm256_unpackhi_ps(rx, ry); // x2 y2 x3 y3 | x6 y6 x7 y7
+        __m256 t2 = _mm256_unpacklo_ps(rz, rw); // z0 w0 z1 w1 | z4 w4 z5 w5
+        __m256 t3 = _mm256_unpackhi_ps(rz, rw); // z2 w2 z3 w3 | z6 w6 z7 w7
+        __m256 v0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)); // vertex 0 | vertex 4
+        __m256 v1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)); // vertex 1 | vertex 5
+        __m256 v2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)); // vertex 2 | vertex 6
+        __m256 v3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)); // vertex 3 | vertex 7
+        _mm256_storeu_ps(&out[i + 0].x, _mm256_permute2f128_ps(v0, v1, 0x20));
+        _mm256_storeu_ps(&out[i + 2].x, _mm256_permute2f128_ps(v2, v3, 0x20));
+        _mm256_storeu_ps(&out[i + 4].x, _mm256_permute2f128_ps(v0, v1, 0x31));
+        _mm256_storeu_ps(&out[i + 6].x, _mm256_permute2f128_ps(v2, v3, 0x31));
+    }
+    transform_vertices_scalar(m, xs + i, ys + i, zs + i, out + i, count - i);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 indexed kernel, gathering 8 vertices and scattering their results back
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2")))
+static void transform_vertices_indexed_avx2(mat4_t* m, float* xs, float* ys, float* zs, int* indices, vec4_t* out, int count) {
+    __m256 m00 = _mm256_set1_ps(m->m[0][0]), m01 = _mm256_set1_ps(m->m[0][1]), m02 = _mm256_set1_ps(m->m[0][2]), m03 = _mm256_set1_ps(m->m[0][3]);
+    __m256 m10 = _mm256_set1_ps(m->m[1][0]), m11 = _mm256_set1_ps(m->m[1][1]), m12 = _mm256_set1_ps(m->m[1][2]), m13 = _mm256_set1_ps(m->m[1][3]);
+    __m256 m20 = _mm256_set1_ps(m->m[2][0]), m21 = _mm256_set1_ps(m->m[2][1]), m22 = _mm256_set1_ps(m->m[2][2]), m23 = _mm256_set1_ps(m->m[2][3]);
+    __m256 m30 = _mm256_set1_ps(m->m[3][0]), m31 = _mm256_set1_ps(m->m[3][1]), m32 = _mm256_set1_ps(m->m[3][2]), m33 = _mm256_set1_ps(m->m[3][3]);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_loadu_si256((__m256i*)&indices[i]);
+        __m256 x = _mm256_i32gather_ps(xs, index, 4);
+        __m256 y = _mm256_i32gather_ps(ys, index, 4);
+        __m256 z = _mm256_i32gather_ps(zs, index, 4);
+
+        __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, x), _mm256_mul_ps(m01, y)), _mm256_mul_ps(m02, z)), m03);
+        __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m10, x), _mm256_mul_ps(m11, y)), _mm256_mul_ps(m12, z)), m13);
+        __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m20, x), _mm256_mul_ps(m21, y)), _mm256_mul_ps(m22, z)), m23);
+        __m256 rw = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m30, x), _mm256_mul_ps(m31, y)), _mm256_mul_ps(m32, z)), m33);
+
+        // Transpose the x, y, z, w lanes back into eight vec4_t vertices
+        __m256 t0 = _mm256_unpacklo_ps(rx, ry);
+        __m256 t1 = _mm256_unpackhi_ps(rx, ry);
+        __m256 t2 = _mm256_unpacklo_ps(rz, rw);
+        __m256 t3 = _mm256_unpackhi_ps(rz, rw);
+        __m256 v0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)); // vertex 0 | vertex 4
+        __m256 v1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)); // vertex 1 | vertex 5
+        __m256 v2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)); // vertex 2 | vertex 6
+        __m256 v3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)); // vertex 3 | vertex 7
+        _mm_storeu_ps(&out[indices[i + 0]].x, _mm256_castps256_ps128(v0));
+        _mm_storeu_ps(&out[indices[i + 1]].x, _mm256_castps256_ps128(v1));
+        _mm_storeu_ps(&out[indices[i + 2]].x, _mm256_castps256_ps128(v2));
+        _mm_storeu_ps(&out[indices[i + 3]].x, _mm256_castps256_ps128(v3));
+        _mm_storeu_ps(&out[indices[i + 4]].x, _mm256_extractf128_ps(v0, 1));
+        _mm_storeu_ps(&out[indices[i + 5]].x, _mm256_extractf128_ps(v1, 1));
+        _mm_storeu_ps(&out[indices[i + 6]].x, _mm256_extractf128_ps(v2, 1));
+        _mm_storeu_ps(&out[indices[i + 7]].x, _mm256_extractf128_ps(v3, 1));
+    }
+    transform_vertices_indexed_scalar(m, xs, ys, zs, indices + i, out, count - i);
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Check with CPUID if the current processor can run a given kernel
+///////////////////////////////////////////////////////////////////////////////
+static bool is_transform_kernel_supported(int kernel) {
+#ifdef TRANSFORM_X86_KERNELS
+    __builtin_cpu_init();
+    if (kernel == TRANSFORM_KERNEL_AVX2) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (kernel == TRANSFORM_KERNEL_SSE) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    return kernel == TRANSFORM_KERNEL_SCALAR;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Pick the widest kernel supported by the processor at runtime
+///////////////////////////////////////////////////////////////////////////////
+void init_transform_kernel(void) {
+    if (is_transform_kernel_supported(TRANSFORM_KERNEL_AVX2)) {
+        transform_kernel = TRANSFORM_KERNEL_AVX2;
+    } else if (is_transform_kernel_supported(TRANSFORM_KERNEL_SSE)) {
+        transform_kernel = TRANSFORM_KERNEL_SSE;
+    } else {
+        transform_kernel = TRANSFORM_KERNEL_SCALAR;
+    }
+}
+
+void set_transform_kernel(int kernel) {
+    transform_kernel = is_transform_kernel_supported(kernel) ? kernel : TRANSFORM_KERNEL_SCALAR;
+}
+
+int get_transform_kernel(void) {
+    return transform_kernel;
+}
+
+const char* get_transform_kernel_name(void) {
+    switch (transform_kernel) {
+        case TRANSFORM_KERNEL_AVX2: return "avx2";
+        case TRANSFORM_KERNEL_SSE: return "sse";
+        default: return "scalar";
+    }
+}
+
+void transform_vertices(mat4_t* m, float* xs, float* ys, float* zs, vec4_t* out, int count) {
+#ifdef TRANSFORM_X86_KERNELS
+    if (transform_kernel == TRANSFORM_KERNEL_AVX2) {
+        transform_vertices_avx2(m, xs, ys, zs, out, count);
+        return;
+    }
+    if (transform_kernel == TRANSFORM_KERNEL_SSE) {
+        transform_vertices_sse(m, xs, ys, zs, out, count);
+        return;
+    }
+#endif
+    transform_vertices_scalar(m, xs, ys, zs, out, count);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Transform only the vertices listed in indices, used when culling leaves a
+// sparse subset of the mesh vertices. The SSE kernel has no gather, so it
+// falls back to the scalar kernel.
+///////////////////////////////////////////////////////////////////////////////
+void transform_vertices_indexed(mat4_t* m, float* xs, float* ys, float* zs, int* indices, vec4_t* out, int count) {
+#ifdef TRANSFORM_X86_KERNELS
+    if (transform_kernel == TRANSFORM_KERNEL_AVX2) {
+        transform_vertices_indexed_avx2(m, xs, ys, zs, indices, out, count);
+        return;
+    }
+#endif
+    transform_vertices_indexed_scalar(m, xs, ys, zs, indices, out, count);
+}
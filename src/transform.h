@@ -0,0 +1,37 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "vector.h"
+#include "matrix.h"
+
+enum transform_kernel {
+    TRANSFORM_KERNEL_SCALAR,
+    TRANSFORM_KERNEL_SSE,
+    TRANSFORM_KERNEL_AVX2
+};
+
+void init_transform_kernel(void);
+void set_transform_kernel(int kernel);
+int get_transform_kernel(void);
+const char* get_transform_kernel_name(void);
+
+void transform_vertices(
+    mat4_t* m,        // Matrix applied to every vertex (w is assumed to be 1)
+    float* xs,        // Structure-of-arrays x positions
+    float* ys,        // Structure-of-arrays y positions
+    float* zs,        // Structure-of-arrays z positions
+    vec4_t* out,      // Output array of transformed vertices
+    int count
+);
+
+void transform_vertices_indexed(
+    mat4_t* m,        // Matrix applied to every vertex (w is assumed to be 1)
+    float* xs,        // Structure-of-arrays x positions
+    float* ys,        // Structure-of-arrays y positions
+    float* zs,        // Structure-of-arrays z positions
+    int* indices,     // Indices of the vertices to transform
+    vec4_t* out,      // Output array of transformed vertices, written at the same indices
+    int count         // Number of indices
+);
+
+#endif
@@ -1,7 +1,14 @@
+#include <stdlib.h>
 #include "display.h"
+#include "stats.h"
 #include "swap.h"
 #include "triangle.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RASTER_X86_KERNELS
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // Return the normal vector of a triangle face
 ///////////////////////////////////////////////////////////////////////////////
@@ -24,23 +31,37 @@ vec3_t get_triangle_normal(vec4_t vertices[3]) {
     return normal;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Snaps a screen space vertex to 28.4 fixed-point subpixel coordinates
+///////////////////////////////////////////////////////////////////////////////
+vec2i_t snap_to_subpixel(screen_point_t* v) {
+    vec2i_t result = {
+        (int)floor(v->x * SUBPIXEL_SCALE + 0.5f),
+        (int)floor(v->y * SUBPIXEL_SCALE + 0.5f)
+    };
+    return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Checks if a triangle edge is top-left
 ///////////////////////////////////////////////////////////////////////////////
-bool is_top_left(vec2_t* start, vec2_t* end) {
-    vec2_t edge = { end->x - start->x, end->y - start->y };
+bool is_top_left(vec2i_t* start, vec2i_t* end) {
+    vec2i_t edge = { end->x - start->x, end->y - start->y };
     bool is_top_edge = edge.y == 0 && edge.x > 0;
     bool is_left_edge = edge.y < 0;
     return is_left_edge || is_top_edge;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Performs the 2D edge-cross between 2 vertices and a point
+// Performs the 2D edge-cross between 2 fixed-point vertices and a point.
+// The result is exact, in units of 1/(SUBPIXEL_SCALE^2) of a pixel area.
 ///////////////////////////////////////////////////////////////////////////////
-float edge_cross(vec2_t* a, vec2_t* b, vec2_t* p) {
-    vec2_t ab = { b->x - a->x, b->y - a->y };
-    vec2_t ap = { p->x - a->x, p->y - a->y };
-    return ab.x * ap.y - ab.y * ap.x;
+int64_t edge_cross(vec2i_t* a, vec2i_t* b, vec2i_t* p) {
+    int64_t ab_x = b->x - a->x;
+    int64_t ab_y = b->y - a->y;
+    int64_t ap_x = p->x - a->x;
+    int64_t ap_y = p->y - a->y;
+    return ab_x * ap_y - ab_y * ap_x;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -56,6 +77,705 @@ void draw_wire_triangle(
     draw_line(v1->x, v1->y, v2->x, v2->y, color);
     draw_line(v2->x, v2->y, v0->x, v0->y, color);
 }
+///////////////////////////////////////////////////////////////////////////////
+// Triangle setup: snap the vertices, cull back faces, clip the bounding box,
+// and compute the edge functions and the 1/w plane of the first pixel.
+// Returns false if the triangle has no candidate pixels to rasterize.
+///////////////////////////////////////////////////////////////////////////////
+bool setup_triangle(triangle_setup_t* setup, screen_point_t* v0, screen_point_t* v1, screen_point_t* v2, rect_t* clip) {
+    // Snap the screen vertices v0, v1, and v2 to fixed-point subpixel coordinates
+    vec2i_t sv0 = snap_to_subpixel(v0);
+    vec2i_t sv1 = snap_to_subpixel(v1);
+    vec2i_t sv2 = snap_to_subpixel(v2);
+
+    // Compute the area of the entire triangle/parallelogram
+    int64_t area = edge_cross(&sv0, &sv1, &sv2);
+
+    // Back-face culling using the signed-area
+    if (area <= 0) {
+        return false;
+    }
+
+    // Finds the bounding box with all candidate pixels, inside the clipping rectangle
+    rect_t* bounds = &setup->bounds;
+    bounds->x_min = MAX((int)floor((float)MIN(MIN(sv0.x, sv1.x), sv2.x) / SUBPIXEL_SCALE), clip->x_min);
+    bounds->y_min = MAX((int)floor((float)MIN(MIN(sv0.y, sv1.y), sv2.y) / SUBPIXEL_SCALE), clip->y_min);
+    bounds->x_max = MIN((int)floor((float)MAX(MAX(sv0.x, sv1.x), sv2.x) / SUBPIXEL_SCALE), clip->x_max);
+    bounds->y_max = MIN((int)floor((float)MAX(MAX(sv0.y, sv1.y), sv2.y) / SUBPIXEL_SCALE), clip->y_max);
+    if (bounds->x_min > bounds->x_max || bounds->y_min > bounds->y_max) {
+        return false;
+    }
+
+    // Compute the constant deltas that will be used for the horizontal and vertical steps of one pixel
+    setup->delta_w_col[0] = (int64_t)(sv1.y - sv2.y) * SUBPIXEL_SCALE;
+    setup->delta_w_col[1] = (int64_t)(sv2.y - sv0.y) * SUBPIXEL_SCALE;
+    setup->delta_w_col[2] = (int64_t)(sv0.y - sv1.y) * SUBPIXEL_SCALE;
+    setup->delta_w_row[0] = (int64_t)(sv2.x - sv1.x) * SUBPIXEL_SCALE;
+    setup->delta_w_row[1] = (int64_t)(sv0.x - sv2.x) * SUBPIXEL_SCALE;
+    setup->delta_w_row[2] = (int64_t)(sv1.x - sv0.x) * SUBPIXEL_SCALE;
+
+    // Rasterization fill rule, pixels exactly on an edge are only drawn if it is a top or left edge
+    int64_t bias0 = is_top_left(&sv1, &sv2) ? 0 : -1;
+    int64_t bias1 = is_top_left(&sv2, &sv0) ? 0 : -1;
+    int64_t bias2 = is_top_left(&sv0, &sv1) ? 0 : -1;
+
+    // Compute the edge functions for the center of the first (top-left) pixel
+    vec2i_t p0 = { bounds->x_min * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2, bounds->y_min * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2 };
+    setup->w[0] = edge_cross(&sv1, &sv2, &p0) + bias0;
+    setup->w[1] = edge_cross(&sv2, &sv0, &p0) + bias1;
+    setup->w[2] = edge_cross(&sv0, &sv1, &p0) + bias2;
+
+    setup->inv_area = 1.0 / area;
+    setup->reciprocal_w = setup_attribute_plane(setup, v0->inv_w, v1->inv_w, v2->inv_w);
+    setup->max_reciprocal_w = MAX(MAX(v0->inv_w, v1->inv_w), v2->inv_w);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Compute the screen-space plane of a value given at the three vertices.
+// The edge functions are the unnormalized barycentric weights, so the plane
+// is the weighted sum of the vertex values and of the edge function deltas.
+///////////////////////////////////////////////////////////////////////////////
+attribute_plane_t setup_attribute_plane(triangle_setup_t* setup, float a0, float a1, float a2) {
+    attribute_plane_t plane = {
+        .origin = ((double)a0 * setup->w[0] + (double)a1 * setup->w[1] + (double)a2 * setup->w[2]) * setup->inv_area,
+        .dx = ((double)a0 * setup->delta_w_col[0] + (double)a1 * setup->delta_w_col[1] + (double)a2 * setup->delta_w_col[2]) * setup->inv_area,
+        .dy = ((double)a0 * setup->delta_w_row[0] + (double)a1 * setup->delta_w_row[1] + (double)a2 * setup->delta_w_row[2]) * setup->inv_area
+    };
+    return plane;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Value of an attribute plane at the center of pixel (x, y). Depth is always
+// evaluated with this exact expression, row value plus dx times the column,
+// so every pixel loop and SIMD kernel computes bit-identical depths no matter
+// how the row was split into spans.
+///////////////////////////////////////////////////////////////////////////////
+static float evaluate_plane(triangle_setup_t* setup, attribute_plane_t* plane, int x, int y) {
+    return plane->origin + plane->dy * (y - setup->bounds.y_min) + plane->dx * (x - setup->bounds.x_min);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Edge function i of the triangle at the center of pixel (x, y)
+///////////////////////////////////////////////////////////////////////////////
+static int64_t evaluate_edge(triangle_setup_t* setup, int i, int x, int y) {
+    return setup->w[i] + setup->delta_w_col[i] * (x - setup->bounds.x_min) + setup->delta_w_row[i] * (y - setup->bounds.y_min);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Checks if the center of pixel (x, y) is inside the triangle
+///////////////////////////////////////////////////////////////////////////////
+static bool is_pixel_inside(triangle_setup_t* setup, int x, int y) {
+    return (evaluate_edge(setup, 0, x, y) | evaluate_edge(setup, 1, x, y) | evaluate_edge(setup, 2, x, y)) >= 0;
+}
+
+// Draws the pixels x_start..x_end (inclusive) of row y of a triangle
+typedef void (*span_function_t)(void* data, triangle_setup_t* setup, int x_start, int x_end, int y);
+
+///////////////////////////////////////////////////////////////////////////////
+// Work done by the rasterizer for one triangle, tallied in locals and added
+// to the stats of the thread once the triangle is drawn
+///////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    int num_hiz_culled_pixels;
+    int num_visible_blocks;
+    int num_tested_pixels;
+    int num_written_pixels;
+} raster_counts_t;
+
+static void add_raster_stats(raster_counts_t* counts) {
+#if RENDER_STATS
+    stats_t* stats = get_current_thread_stats();
+    if (counts->num_hiz_culled_pixels > 0) {
+        STAT_ADD(stats, STAT_TRIANGLES_HIZ_CULLED, counts->num_visible_blocks == 0 ? 1 : 0);
+        STAT_ADD(stats, STAT_PIXELS_HIZ_CULLED, counts->num_hiz_culled_pixels);
+    }
+    STAT_ADD(stats, STAT_PIXELS_TESTED, counts->num_tested_pixels);
+    STAT_ADD(stats, STAT_PIXELS_DEPTH_REJECTED, counts->num_tested_pixels - counts->num_written_pixels);
+    STAT_ADD(stats, STAT_PIXELS_WRITTEN, counts->num_written_pixels);
+#endif
+}
+
+// Depth margin of the Hi-Z test, larger than the rounding of the per-pixel 1/w evaluation
+#define HIZ_DEPTH_EPSILON 1e-4f
+
+///////////////////////////////////////////////////////////////////////////////
+// Walk the candidate pixels of a triangle one row of Hi-Z blocks at a time
+///////////////////////////////////////////////////////////////////////////////
+// A block is skipped when the nearest depth the triangle can have inside it
+// is behind the farthest depth already stored in the block. The nearest depth
+// comes from the largest 1/w at the block corners (1/w is linear in screen
+// space) and of the three vertices. The spans of the visible blocks are
+// drawn with draw_span, and their Hi-Z entries are refreshed afterwards if
+// the spans write depth. The blocks and pixels rejected are added to counts.
+///////////////////////////////////////////////////////////////////////////////
+static void rasterize_triangle(triangle_setup_t* setup, span_function_t draw_span, void* data, bool writes_depth, raster_counts_t* counts) {
+    rect_t* bounds = &setup->bounds;
+    float* hiz_buffer = get_hiz_buffer();
+    int hiz_width = get_hiz_width();
+
+    int block_x_min = bounds->x_min / HIZ_BLOCK_SIZE;
+    int block_x_max = bounds->x_max / HIZ_BLOCK_SIZE;
+    int block_y_min = bounds->y_min / HIZ_BLOCK_SIZE;
+    int block_y_max = bounds->y_max / HIZ_BLOCK_SIZE;
+    bool is_block_visible[block_x_max - block_x_min + 1];
+    float covered_block_depth[block_x_max - block_x_min + 1];
+
+    int num_visible_blocks = 0;
+    int num_culled_pixels = 0;
+
+    for (int block_y = block_y_min; block_y <= block_y_max; block_y++) {
+        int y_start = MAX(block_y * HIZ_BLOCK_SIZE, bounds->y_min);
+        int y_end = MIN(block_y * HIZ_BLOCK_SIZE + HIZ_BLOCK_SIZE - 1, bounds->y_max);
+        bool is_any_block_visible = false;
+
+        // Test the nearest depth of the triangle inside each block against the Hi-Z buffer
+        for (int block_x = block_x_min; block_x <= block_x_max; block_x++) {
+            int x_start = MAX(block_x * HIZ_BLOCK_SIZE, bounds->x_min);
+            int x_end = MIN(block_x * HIZ_BLOCK_SIZE + HIZ_BLOCK_SIZE - 1, bounds->x_max);
+
+            float corner_reciprocal_w[4] = {
+                evaluate_plane(setup, &setup->reciprocal_w, x_start, y_start),
+                evaluate_plane(setup, &setup->reciprocal_w, x_end, y_start),
+                evaluate_plane(setup, &setup->reciprocal_w, x_start, y_end),
+                evaluate_plane(setup, &setup->reciprocal_w, x_end, y_end)
+            };
+            float max_reciprocal_w = MAX(MAX(corner_reciprocal_w[0], corner_reciprocal_w[1]), MAX(corner_reciprocal_w[2], corner_reciprocal_w[3]));
+            float min_reciprocal_w = MIN(MIN(corner_reciprocal_w[0], corner_reciprocal_w[1]), MIN(corner_reciprocal_w[2], corner_reciprocal_w[3]));
+            float nearest_depth = 1.0 - MIN(max_reciprocal_w, setup->max_reciprocal_w);
+
+            // A block whose four corner pixels are inside the triangle is fully covered, and after
+            // drawing it no pixel of the block can be farther than the farthest depth of the triangle
+            bool is_block_covered =
+                x_end - x_start == HIZ_BLOCK_SIZE - 1 && y_end - y_start == HIZ_BLOCK_SIZE - 1 &&
+                is_pixel_inside(setup, x_start, y_start) && is_pixel_inside(setup, x_end, y_start) &&
+                is_pixel_inside(setup, x_start, y_end) && is_pixel_inside(setup, x_end, y_end);
+            covered_block_depth[block_x - block_x_min] = is_block_covered ? 1.0 - min_reciprocal_w : -1.0;
+
+            bool is_visible = nearest_depth - HIZ_DEPTH_EPSILON < hiz_buffer[(hiz_width * block_y) + block_x];
+            is_block_visible[block_x - block_x_min] = is_visible;
+            if (is_visible) {
+                is_any_block_visible = true;
+                num_visible_blocks++;
+            } else {
+                num_culled_pixels += (x_end - x_start + 1) * (y_end - y_start + 1);
+            }
+        }
+        if (!is_any_block_visible) {
+            continue;
+        }
+
+        // Draw the runs of consecutive visible blocks one row at a time
+        for (int y = y_start; y <= y_end; y++) {
+            for (int block_x = block_x_min; block_x <= block_x_max; block_x++) {
+                if (!is_block_visible[block_x - block_x_min]) {
+                    continue;
+                }
+                int run_end = block_x;
+                while (run_end < block_x_max && is_block_visible[run_end + 1 - block_x_min]) {
+                    run_end++;
+                }
+                int x_start = MAX(block_x * HIZ_BLOCK_SIZE, bounds->x_min);
+                int x_end = MIN(run_end * HIZ_BLOCK_SIZE + HIZ_BLOCK_SIZE - 1, bounds->x_max);
+                draw_span(data, setup, x_start, x_end, y);
+                block_x = run_end;
+            }
+        }
+
+        // Refresh the farthest depth of the blocks that were drawn. Fully covered blocks
+        // only need a min with the triangle, partially covered ones are read back.
+        for (int block_x = block_x_min; block_x <= block_x_max && writes_depth; block_x++) {
+            if (!is_block_visible[block_x - block_x_min]) {
+                continue;
+            }
+            if (covered_block_depth[block_x - block_x_min] >= 0.0) {
+                float* max_depth = &hiz_buffer[(hiz_width * block_y) + block_x];
+                *max_depth = MIN(*max_depth, covered_block_depth[block_x - block_x_min]);
+            } else {
+                update_hiz_block(block_x, block_y);
+            }
+        }
+    }
+
+    STAT_COUNT(counts->num_hiz_culled_pixels, num_culled_pixels);
+    STAT_COUNT(counts->num_visible_blocks, num_visible_blocks);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Per-triangle values used by the scalar and SIMD textured pixel loops
+///////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    triangle_setup_t* setup;
+    attribute_plane_t u_over_w;
+    attribute_plane_t v_over_w;
+    int texture_width;
+    int texture_height;
+    uint32_t* texture_buffer;
+    int depth_test;
+    bool counts_overdraw;  // Count the depth tests and passes of each pixel for the overdraw heatmap
+    raster_counts_t counts;
+} textured_span_t;
+
+///////////////////////////////////////////////////////////////////////////////
+// Edge functions and interpolated values at the current pixel of a row,
+// advanced by the pixel loops as they step to the right
+///////////////////////////////////////////////////////////////////////////////
+typedef struct {
+    int64_t w[3];
+    float reciprocal_w_row;  // 1/w, U/w, and V/w at the first candidate pixel of the row, see evaluate_plane
+    float u_over_w_row;
+    float v_over_w_row;
+} raster_cursor_t;
+
+static int raster_kernel = RASTER_KERNEL_SCALAR;
+
+///////////////////////////////////////////////////////////////////////////////
+// Add the depth tests and passes of a group of SIMD lanes, one bit per pixel
+// starting at overdraw[0], to the overdraw counts
+///////////////////////////////////////////////////////////////////////////////
+static void count_overdraw_lanes(overdraw_t* overdraw, int tested_lanes, int passed_lanes) {
+    for (; tested_lanes != 0; tested_lanes &= tested_lanes - 1) {
+        int lane = __builtin_ctz(tested_lanes);
+        overdraw[lane].num_tests++;
+        overdraw[lane].num_passes += (passed_lanes >> lane) & 1;
+    }
+}
+
+#ifdef RASTER_X86_KERNELS
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 coverage mask of 8 horizontal pixels, one bit per pixel
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2")))
+static inline int coverage_mask_avx2(raster_cursor_t* c, __m256i w0_lo, __m256i w0_hi, __m256i w1_lo, __m256i w1_hi, __m256i w2_lo, __m256i w2_hi) {
+    // A pixel is inside when the sign bit of (w0 | w1 | w2) is clear
+    __m256i e_lo = _mm256_or_si256(
+        _mm256_or_si256(_mm256_add_epi64(_mm256_set1_epi64x(c->w[0]), w0_lo), _mm256_add_epi64(_mm256_set1_epi64x(c->w[1]), w1_lo)),
+        _mm256_add_epi64(_mm256_set1_epi64x(c->w[2]), w2_lo)
+    );
+    __m256i e_hi = _mm256_or_si256(
+        _mm256_or_si256(_mm256_add_epi64(_mm256_set1_epi64x(c->w[0]), w0_hi), _mm256_add_epi64(_mm256_set1_epi64x(c->w[1]), w1_hi)),
+        _mm256_add_epi64(_mm256_set1_epi64x(c->w[2]), w2_hi)
+    );
+    return ~(_mm256_movemask_pd(_mm256_castsi256_pd(e_lo)) | (_mm256_movemask_pd(_mm256_castsi256_pd(e_hi)) << 4)) & 0xFF;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 textured span, 8 horizontal pixels per iteration
+///////////////////////////////////////////////////////////////////////////////
+// Evaluates the edge functions, coverage mask, depth test, and perspective
+// correct UVs of 8 pixels at once, gathers the 8 texels, and writes color
+// and depth with masked stores. Returns the first pixel it did not process,
+// so the caller can finish the row with the scalar loop.
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2")))
+static int draw_textured_span_avx2(
+    textured_span_t* t, raster_cursor_t* c, int x, int x_max,
+    uint32_t* color_row, float* depth_row, overdraw_t* overdraw_row
+) {
+    int64_t d0 = t->setup->delta_w_col[0];
+    int64_t d1 = t->setup->delta_w_col[1];
+    int64_t d2 = t->setup->delta_w_col[2];
+    int x_origin = t->setup->bounds.x_min;
+
+    // Edge function offsets of each lane from the first pixel of the span (64-bit lanes, 4 per register)
+    __m256i w0_lo = _mm256_set_epi64x(3 * d0, 2 * d0, d0, 0), w0_hi = _mm256_set_epi64x(7 * d0, 6 * d0, 5 * d0, 4 * d0);
+    __m256i w1_lo = _mm256_set_epi64x(3 * d1, 2 * d1, d1, 0), w1_hi = _mm256_set_epi64x(7 * d1, 6 * d1, 5 * d1, 4 * d1);
+    __m256i w2_lo = _mm256_set_epi64x(3 * d2, 2 * d2, d2, 0), w2_hi = _mm256_set_epi64x(7 * d2, 6 * d2, 5 * d2, 4 * d2);
+
+    // Values at the first candidate pixel of the row and their change for each pixel to the right
+    __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 rw_row = _mm256_set1_ps(c->reciprocal_w_row);
+    __m256 rw_dx = _mm256_set1_ps(t->setup->reciprocal_w.dx);
+    __m256 uw_row = _mm256_set1_ps(c->u_over_w_row);
+    __m256 uw_dx = _mm256_set1_ps(t->u_over_w.dx);
+    __m256 vw_row = _mm256_set1_ps(c->v_over_w_row);
+    __m256 vw_dx = _mm256_set1_ps(t->v_over_w.dx);
+
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 texture_width_f = _mm256_set1_ps((float)t->texture_width);
+    __m256 texture_height_f = _mm256_set1_ps((float)t->texture_height);
+    __m256 inv_texture_width = _mm256_set1_ps(1.0f / t->texture_width);
+    __m256 inv_texture_height = _mm256_set1_ps(1.0f / t->texture_height);
+    __m256i texture_width = _mm256_set1_epi32(t->texture_width);
+    __m256i texture_height = _mm256_set1_epi32(t->texture_height);
+    __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i zero = _mm256_setzero_si256();
+    bool is_depth_equal = t->depth_test == DEPTH_TEST_EQUAL;
+
+    for (; x + 7 <= x_max; x += 8) {
+        int coverage = coverage_mask_avx2(c, w0_lo, w0_hi, w1_lo, w1_hi, w2_lo, w2_hi);
+
+        if (coverage) {
+            // Interpolate 1/w and run the depth test against the z-buffer
+            __m256 column = _mm256_add_ps(_mm256_set1_ps((float)(x - x_origin)), lanes);
+            __m256 reciprocal_w = _mm256_add_ps(rw_row, _mm256_mul_ps(rw_dx, column));
+            __m256 depth = _mm256_sub_ps(one, reciprocal_w);
+            __m256 depth_pass = is_depth_equal ?
+                _mm256_cmp_ps(depth, _mm256_loadu_ps(&depth_row[x]), _CMP_EQ_OQ) :
+                _mm256_cmp_ps(depth, _mm256_loadu_ps(&depth_row[x]), _CMP_LT_OQ);
+
+            // Expand the coverage bits into lane masks and combine them with the depth test
+            __m256i coverage_mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(coverage), lane_bits), lane_bits);
+            __m256i mask = _mm256_and_si256(coverage_mask, _mm256_castps_si256(depth_pass));
+            STAT_COUNT(t->counts.num_tested_pixels, __builtin_popcount(coverage));
+            if (overdraw_row != NULL) {
+                count_overdraw_lanes(&overdraw_row[x], coverage, _mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+            }
+
+            if (!_mm256_testz_si256(mask, mask)) {
+                // Perspective correct U and V, with one reciprocal per pixel
+                __m256 w = _mm256_div_ps(one, reciprocal_w);
+                __m256 u = _mm256_mul_ps(_mm256_add_ps(uw_row, _mm256_mul_ps(uw_dx, column)), w);
+                __m256 v = _mm256_mul_ps(_mm256_add_ps(vw_row, _mm256_mul_ps(vw_dx, column)), w);
+
+                // Map the UVs to texels, abs((int)(u * width)) % width
+                __m256i tex_x = _mm256_abs_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(u, texture_width_f)));
+                __m256i tex_y = _mm256_abs_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(v, texture_height_f)));
+                tex_x = _mm256_sub_epi32(tex_x, _mm256_mullo_epi32(texture_width, _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(tex_x), inv_texture_width))));
+                tex_y = _mm256_sub_epi32(tex_y, _mm256_mullo_epi32(texture_height, _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(tex_y), inv_texture_height))));
+
+                // The float quotient can be off by one, so bring the remainders back into [0, size)
+                tex_x = _mm256_add_epi32(tex_x, _mm256_and_si256(_mm256_cmpgt_epi32(zero, tex_x), texture_width));
+                tex_y = _mm256_add_epi32(tex_y, _mm256_and_si256(_mm256_cmpgt_epi32(zero, tex_y), texture_height));
+                tex_x = _mm256_sub_epi32(tex_x, _mm256_andnot_si256(_mm256_cmpgt_epi32(texture_width, tex_x), texture_width));
+                tex_y = _mm256_sub_epi32(tex_y, _mm256_andnot_si256(_mm256_cmpgt_epi32(texture_height, tex_y), texture_height));
+
+                // Gather the texels of the visible pixels and store color and depth
+                __m256i texel_index = _mm256_add_epi32(_mm256_mullo_epi32(tex_y, texture_width), tex_x);
+                __m256i texels = _mm256_mask_i32gather_epi32(zero, (int*)t->texture_buffer, texel_index, mask, 4);
+                _mm256_maskstore_epi32((int*)&color_row[x], mask, texels);
+                if (!is_depth_equal) {
+                    _mm256_maskstore_ps(&depth_row[x], mask, depth);
+                }
+                STAT_COUNT(t->counts.num_written_pixels, __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(mask))));
+            }
+        }
+
+        c->w[0] += 8 * d0;
+        c->w[1] += 8 * d1;
+        c->w[2] += 8 * d2;
+    }
+    return x;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// AVX2 depth-only span, 8 horizontal pixels per iteration
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2")))
+static int draw_depth_span_avx2(
+    triangle_setup_t* setup, raster_cursor_t* c, int x, int x_max,
+    float* depth_row
+) {
+    int64_t d0 = setup->delta_w_col[0];
+    int64_t d1 = setup->delta_w_col[1];
+    int64_t d2 = setup->delta_w_col[2];
+    int x_origin = setup->bounds.x_min;
+
+    __m256i w0_lo = _mm256_set_epi64x(3 * d0, 2 * d0, d0, 0), w0_hi = _mm256_set_epi64x(7 * d0, 6 * d0, 5 * d0, 4 * d0);
+    __m256i w1_lo = _mm256_set_epi64x(3 * d1, 2 * d1, d1, 0), w1_hi = _mm256_set_epi64x(7 * d1, 6 * d1, 5 * d1, 4 * d1);
+    __m256i w2_lo = _mm256_set_epi64x(3 * d2, 2 * d2, d2, 0), w2_hi = _mm256_set_epi64x(7 * d2, 6 * d2, 5 * d2, 4 * d2);
+
+    __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 rw_row = _mm256_set1_ps(c->reciprocal_w_row);
+    __m256 rw_dx = _mm256_set1_ps(setup->reciprocal_w.dx);
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    for (; x + 7 <= x_max; x += 8) {
+        int coverage = coverage_mask_avx2(c, w0_lo, w0_hi, w1_lo, w1_hi, w2_lo, w2_hi);
+
+        if (coverage) {
+            __m256 column = _mm256_add_ps(_mm256_set1_ps((float)(x - x_origin)), lanes);
+            __m256 depth = _mm256_sub_ps(one, _mm256_add_ps(rw_row, _mm256_mul_ps(rw_dx, column)));
+            __m256 depth_pass = _mm256_cmp_ps(depth, _mm256_loadu_ps(&depth_row[x]), _CMP_LT_OQ);
+            __m256i coverage_mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(coverage), lane_bits), lane_bits);
+            _mm256_maskstore_ps(&depth_row[x], _mm256_and_si256(coverage_mask, _mm256_castps_si256(depth_pass)), depth);
+        }
+
+        c->w[0] += 8 * d0;
+        c->w[1] += 8 * d1;
+        c->w[2] += 8 * d2;
+    }
+    return x;
+}
+
+// Number of bits set in a 4-bit lane mask, SSE2 targets have no popcnt instruction
+static inline int count_lanes_sse2(int mask) {
+    return (0x4332322132212110ULL >> (mask * 4)) & 0xF;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SSE2 texel coordinate of 4 pixels, abs((int)(uv * size)) % size
+///////////////////////////////////////////////////////////////////////////////
+// SSE2 has no 32-bit integer multiply, so the remainder is computed in float,
+// where it is exact while the texel coordinates stay below 2^24.
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("sse2")))
+static inline __m128 texel_coordinate_sse2(__m128 uv, __m128 size, __m128 inv_size) {
+    // Truncating and taking the absolute value commute, so clear the sign bit first
+    __m128 coordinate = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_mul_ps(uv, size))));
+    __m128 quotient = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(coordinate, inv_size)));
+    __m128 remainder = _mm_sub_ps(coordinate, _mm_mul_ps(quotient, size));
+
+    // The float quotient can be off by one, so bring the remainder back into [0, size)
+    remainder = _mm_add_ps(remainder, _mm_and_ps(_mm_cmplt_ps(remainder, _mm_setzero_ps()), size));
+    return _mm_sub_ps(remainder, _mm_and_ps(_mm_cmpge_ps(remainder, size), size));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SSE2 textured span, 4 horizontal pixels per iteration
+///////////////////////////////////////////////////////////////////////////////
+// Coverage, depth, UVs, and texel addresses are evaluated 4-wide. SSE2 has no
+// gathers or masked stores, so the 4 texels are fetched one by one, with the
+// hidden pixels reading texel 0, and color and depth are blended with what is
+// already in the row and stored 4 pixels at a time.
+///////////////////////////////////////////////////////////////////////////////
+__attribute__((target("sse2")))
+static int draw_textured_span_sse2(
+    textured_span_t* t, raster_cursor_t* c, int x, int x_max,
+    uint32_t* color_row, float* depth_row, overdraw_t* overdraw_row
+) {
+    int64_t d0 = t->setup->delta_w_col[0];
+    int64_t d1 = t->setup->delta_w_col[1];
+    int64_t d2 = t->setup->delta_w_col[2];
+    int x_origin = t->setup->bounds.x_min;
+
+    // Edge functions of the 4 pixels of the span (64-bit lanes, 2 per register), kept in registers
+    // across the loop since the color and depth stores could alias the cursor
+    __m128i w0_lo = _mm_add_epi64(_mm_set1_epi64x(c->w[0]), _mm_set_epi64x(d0, 0));
+    __m128i w0_hi = _mm_add_epi64(_mm_set1_epi64x(c->w[0]), _mm_set_epi64x(3 * d0, 2 * d0));
+    __m128i w1_lo = _mm_add_epi64(_mm_set1_epi64x(c->w[1]), _mm_set_epi64x(d1, 0));
+    __m128i w1_hi = _mm_add_epi64(_mm_set1_epi64x(c->w[1]), _mm_set_epi64x(3 * d1, 2 * d1));
+    __m128i w2_lo = _mm_add_epi64(_mm_set1_epi64x(c->w[2]), _mm_set_epi64x(d2, 0));
+    __m128i w2_hi = _mm_add_epi64(_mm_set1_epi64x(c->w[2]), _mm_set_epi64x(3 * d2, 2 * d2));
+    __m128i step0 = _mm_set1_epi64x(4 * d0);
+    __m128i step1 = _mm_set1_epi64x(4 * d1);
+    __m128i step2 = _mm_set1_epi64x(4 * d2);
+    int x_first = x;
+
+    // Values at the first candidate pixel of the row and their change for each pixel to the right
+    __m128 lanes = _mm_setr_ps(0, 1, 2, 3);
+    __m128 rw_row = _mm_set1_ps(c->reciprocal_w_row);
+    __m128 rw_dx = _mm_set1_ps(t->setup->reciprocal_w.dx);
+    __m128 uw_row = _mm_set1_ps(c->u_over_w_row);
+    __m128 uw_dx = _mm_set1_ps(t->u_over_w.dx);
+    __m128 vw_row = _mm_set1_ps(c->v_over_w_row);
+    __m128 vw_dx = _mm_set1_ps(t->v_over_w.dx);
+
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 texture_width = _mm_set1_ps((float)t->texture_width);
+    __m128 texture_height = _mm_set1_ps((float)t->texture_height);
+    __m128 inv_texture_width = _mm_set1_ps(1.0f / t->texture_width);
+    __m128 inv_texture_height = _mm_set1_ps(1.0f / t->texture_height);
+    __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+    uint32_t* texture_buffer = t->texture_buffer;
+    bool is_depth_equal = t->depth_test == DEPTH_TEST_EQUAL;
+    int num_tested_pixels = 0;
+    int num_written_pixels = 0;
+
+    for (; x + 3 <= x_max; x += 4) {
+        // Coverage: a pixel is inside when the sign bit of (w0 | w1 | w2) is clear
+        __m128i e_lo = _mm_or_si128(_mm_or_si128(w0_lo, w1_lo), w2_lo);
+        __m128i e_hi = _mm_or_si128(_mm_or_si128(w0_hi, w1_hi), w2_hi);
+        int coverage = ~(_mm_movemask_pd(_mm_castsi128_pd(e_lo)) | (_mm_movemask_pd(_mm_castsi128_pd(e_hi)) << 2)) & 0xF;
+        w0_lo = _mm_add_epi64(w0_lo, step0);
+        w0_hi = _mm_add_epi64(w0_hi, step0);
+        w1_lo = _mm_add_epi64(w1_lo, step1);
+        w1_hi = _mm_add_epi64(w1_hi, step1);
+        w2_lo = _mm_add_epi64(w2_lo, step2);
+        w2_hi = _mm_add_epi64(w2_hi, step2);
+
+        if (coverage) {
+            // Interpolate 1/w and run the depth test against the z-buffer
+            __m128 column = _mm_add_ps(_mm_set1_ps((float)(x - x_origin)), lanes);
+            __m128 reciprocal_w = _mm_add_ps(rw_row, _mm_mul_ps(rw_dx, column));
+            __m128 depth = _mm_sub_ps(one, reciprocal_w);
+            __m128 old_depth = _mm_loadu_ps(&depth_row[x]);
+            __m128 depth_pass = is_depth_equal ? _mm_cmpeq_ps(depth, old_depth) : _mm_cmplt_ps(depth, old_depth);
+            int visible = coverage & _mm_movemask_ps(depth_pass);
+            STAT_COUNT(num_tested_pixels, count_lanes_sse2(coverage));
+            STAT_COUNT(num_written_pixels, count_lanes_sse2(visible));
+            if (overdraw_row != NULL) {
+                count_overdraw_lanes(&overdraw_row[x], coverage, visible);
+            }
+
+            if (visible) {
+                // Perspective correct U and V, with one reciprocal per pixel
+                __m128 w = _mm_div_ps(one, reciprocal_w);
+                __m128 u = _mm_mul_ps(_mm_add_ps(uw_row, _mm_mul_ps(uw_dx, column)), w);
+                __m128 v = _mm_mul_ps(_mm_add_ps(vw_row, _mm_mul_ps(vw_dx, column)), w);
+                __m128 tex_x = texel_coordinate_sse2(u, texture_width, inv_texture_width);
+                __m128 tex_y = texel_coordinate_sse2(v, texture_height, inv_texture_height);
+
+                // Texel indices of the visible pixels, the hidden ones read texel 0
+                __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(visible), lane_bits), lane_bits);
+                __m128i texel_index = _mm_and_si128(mask, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(tex_y, texture_width), tex_x)));
+                int indices[4];
+                _mm_storeu_si128((__m128i*)indices, texel_index);
+                __m128i texels = _mm_setr_epi32(
+                    texture_buffer[indices[0]], texture_buffer[indices[1]],
+                    texture_buffer[indices[2]], texture_buffer[indices[3]]
+                );
+
+                // Keep the color and depth already in the row for the hidden pixels
+                __m128i old_color = _mm_loadu_si128((__m128i*)&color_row[x]);
+                _mm_storeu_si128((__m128i*)&color_row[x], _mm_or_si128(_mm_and_si128(mask, texels), _mm_andnot_si128(mask, old_color)));
+                if (!is_depth_equal) {
+                    __m128 depth_mask = _mm_castsi128_ps(mask);
+                    _mm_storeu_ps(&depth_row[x], _mm_or_ps(_mm_and_ps(depth_mask, depth), _mm_andnot_ps(depth_mask, old_depth)));
+                }
+            }
+        }
+    }
+
+    c->w[0] += (x - x_first) * d0;
+    c->w[1] += (x - x_first) * d1;
+    c->w[2] += (x - x_first) * d2;
+    STAT_COUNT(t->counts.num_tested_pixels, num_tested_pixels);
+    STAT_COUNT(t->counts.num_written_pixels, num_written_pixels);
+    return x;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Check with CPUID if the current processor can run a given pixel kernel
+///////////////////////////////////////////////////////////////////////////////
+static bool is_raster_kernel_supported(int kernel) {
+#ifdef RASTER_X86_KERNELS
+    __builtin_cpu_init();
+    if (kernel == RASTER_KERNEL_AVX2) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (kernel == RASTER_KERNEL_SSE2) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    return kernel == RASTER_KERNEL_SCALAR;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Pick the widest pixel kernel supported by the processor at runtime
+///////////////////////////////////////////////////////////////////////////////
+void init_raster_kernel(void) {
+    if (is_raster_kernel_supported(RASTER_KERNEL_AVX2)) {
+        raster_kernel = RASTER_KERNEL_AVX2;
+    } else if (is_raster_kernel_supported(RASTER_KERNEL_SSE2)) {
+        raster_kernel = RASTER_KERNEL_SSE2;
+    } else {
+        raster_kernel = RASTER_KERNEL_SCALAR;
+    }
+}
+
+void set_raster_kernel(int kernel) {
+    raster_kernel = is_raster_kernel_supported(kernel) ? kernel : RASTER_KERNEL_SCALAR;
+}
+
+int get_raster_kernel(void) {
+    return raster_kernel;
+}
+
+const char* get_raster_kernel_name(void) {
+    switch (raster_kernel) {
+        case RASTER_KERNEL_AVX2: return "avx2";
+        case RASTER_KERNEL_SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Draw as many pixels of a textured row as the selected SIMD kernel can,
+// returning the first pixel left for the scalar loop
+///////////////////////////////////////////////////////////////////////////////
+static int draw_textured_span(
+    textured_span_t* t, raster_cursor_t* c, int x, int x_max,
+    uint32_t* color_row, float* depth_row, overdraw_t* overdraw_row
+) {
+#ifdef RASTER_X86_KERNELS
+    if (raster_kernel == RASTER_KERNEL_AVX2) {
+        return draw_textured_span_avx2(t, c, x, x_max, color_row, depth_row, overdraw_row);
+    }
+    if (raster_kernel == RASTER_KERNEL_SSE2) {
+        return draw_textured_span_sse2(t, c, x, x_max, color_row, depth_row, overdraw_row);
+    }
+#endif
+    return x;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Draw as many pixels of a depth-only row as the selected SIMD kernel can,
+// returning the first pixel left for the scalar loop
+///////////////////////////////////////////////////////////////////////////////
+static int draw_depth_span(
+    triangle_setup_t* setup, raster_cursor_t* c, int x, int x_max,
+    float* depth_row
+) {
+#ifdef RASTER_X86_KERNELS
+    if (raster_kernel == RASTER_KERNEL_AVX2) {
+        return draw_depth_span_avx2(setup, c, x, x_max, depth_row);
+    }
+#endif
+    return x;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Draw the pixels x_start..x_end of row y of a textured triangle
+///////////////////////////////////////////////////////////////////////////////
+static void draw_textured_row(void* data, triangle_setup_t* setup, int x_start, int x_end, int y) {
+    textured_span_t* span = (textured_span_t*)data;
+    raster_cursor_t cursor = {
+        .w = { evaluate_edge(setup, 0, x_start, y), evaluate_edge(setup, 1, x_start, y), evaluate_edge(setup, 2, x_start, y) },
+        .reciprocal_w_row = evaluate_plane(setup, &setup->reciprocal_w, setup->bounds.x_min, y),
+        .u_over_w_row = evaluate_plane(setup, &span->u_over_w, setup->bounds.x_min, y),
+        .v_over_w_row = evaluate_plane(setup, &span->v_over_w, setup->bounds.x_min, y)
+    };
+    uint32_t* color_row = &get_color_buffer()[get_color_buffer_pitch() * y];
+    float* depth_row = &get_z_buffer()[get_window_width() * y];
+    overdraw_t* overdraw_row = span->counts_overdraw ? &get_overdraw_buffer()[get_window_width() * y] : NULL;
+    bool is_depth_equal = span->depth_test == DEPTH_TEST_EQUAL;
+
+    // Draw groups of horizontal pixels with the SIMD kernel, and the rest of the row one pixel at a time
+    int x = draw_textured_span(span, &cursor, x_start, x_end, color_row, depth_row, overdraw_row);
+    for (; x <= x_end; x++) {
+        bool is_inside = (cursor.w[0] | cursor.w[1] | cursor.w[2]) >= 0;
+        if (is_inside) {
+            // Adjust 1/w so the pixels that are closer to the camera have smaller values
+            int column = x - setup->bounds.x_min;
+            float reciprocal_w = cursor.reciprocal_w_row + setup->reciprocal_w.dx * column;
+            float depth = 1.0 - reciprocal_w;
+            bool is_visible = is_depth_equal ? depth == depth_row[x] : depth < depth_row[x];
+            STAT_COUNT(span->counts.num_tested_pixels, 1);
+            if (overdraw_row != NULL) {
+                count_overdraw_lanes(&overdraw_row[x], 1, is_visible);
+            }
+
+            // Only draw the pixel if it passes the depth test against the value stored in the z-buffer
+            if (is_visible) {
+                // Divide U/w and V/w back by 1/w, with a single reciprocal
+                float w = 1 / reciprocal_w;
+                float interpolated_u = (cursor.u_over_w_row + span->u_over_w.dx * column) * w;
+                float interpolated_v = (cursor.v_over_w_row + span->v_over_w.dx * column) * w;
+
+                // Map the UV coordinate to the full texture width and height
+                int tex_x = abs((int)(interpolated_u * span->texture_width)) % span->texture_width;
+                int tex_y = abs((int)(interpolated_v * span->texture_height)) % span->texture_height;
+
+                // Draw a pixel at position (x,y) with the color that comes from the mapped texture
+                color_row[x] = span->texture_buffer[(span->texture_width * tex_y) + tex_x];
+
+                // Update the z-buffer value with the 1/w of this current pixel
+                if (!is_depth_equal) {
+                    depth_row[x] = depth;
+                }
+                STAT_COUNT(span->counts.num_written_pixels, 1);
+            }
+        }
+        cursor.w[0] += setup->delta_w_col[0];
+        cursor.w[1] += setup->delta_w_col[1];
+        cursor.w[2] += setup->delta_w_col[2];
+    }
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // Draw a textured triangle based on a texture array of colors.
@@ -78,110 +798,129 @@ void draw_wire_triangle(
 //
 ///////////////////////////////////////////////////////////////////////////////
 void draw_textured_triangle(
-    vec4_t* v0, float v0u, float v0v,
-    vec4_t* v1, float v1u, float v1v,
-    vec4_t* v2, float v2u, float v2v,
-    upng_t* texture
+    screen_point_t* v0, float v0u, float v0v,
+    screen_point_t* v1, float v1u, float v1v,
+    screen_point_t* v2, float v2u, float v2v,
+    upng_t* texture,
+    int depth_test,
+    rect_t* clip
 ) {
+    triangle_setup_t setup;
+    if (!setup_triangle(&setup, v0, v1, v2, clip)) {
+        return;
+    }
+
     // Flip the V component to account for inverted UV-coordinates (V grows downwards)
     v0v = 1.0 - v0v;
     v1v = 1.0 - v1v;
     v2v = 1.0 - v2v;
 
-    // Finds the bounding box with all candidate pixels
-    int x_min = floor(MIN(MIN(v0->x, v1->x), v2->x));
-    int y_min = floor(MIN(MIN(v0->y, v1->y), v2->y));
-    int x_max = ceil(MAX(MAX(v0->x, v1->x), v2->x));
-    int y_max = ceil(MAX(MAX(v0->y, v1->y), v2->y));
-
-    // Screen 2D points from vertices v0, v1, and v2
-    vec2_t sv0 = { v0->x, v0->y };
-    vec2_t sv1 = { v1->x, v1->y };
-    vec2_t sv2 = { v2->x, v2->y };
+    // Planes of U/w and V/w, and the texture values hoisted out of the pixel loop
+    textured_span_t span = {
+        .setup = &setup,
+        .u_over_w = setup_attribute_plane(&setup, v0u * v0->inv_w, v1u * v1->inv_w, v2u * v2->inv_w),
+        .v_over_w = setup_attribute_plane(&setup, v0v * v0->inv_w, v1v * v1->inv_w, v2v * v2->inv_w),
+        .texture_width = upng_get_width(texture),
+        .texture_height = upng_get_height(texture),
+        .texture_buffer = (uint32_t*)upng_get_buffer(texture),
+        .depth_test = depth_test,
+        .counts_overdraw = should_render_overdraw(),
+        .counts = { 0 }
+    };
+
+    rasterize_triangle(&setup, draw_textured_row, &span, depth_test == DEPTH_TEST_LESS, &span.counts);
+    add_raster_stats(&span.counts);
+}
 
-    // Compute the area of the entire triangle/parallelogram
-    float area = edge_cross(&sv0, &sv1, &sv2);
+///////////////////////////////////////////////////////////////////////////////
+// Draw the pixels x_start..x_end of row y of a depth-only triangle
+///////////////////////////////////////////////////////////////////////////////
+static void draw_depth_row(void* data, triangle_setup_t* setup, int x_start, int x_end, int y) {
+    raster_cursor_t cursor = {
+        .w = { evaluate_edge(setup, 0, x_start, y), evaluate_edge(setup, 1, x_start, y), evaluate_edge(setup, 2, x_start, y) },
+        .reciprocal_w_row = evaluate_plane(setup, &setup->reciprocal_w, setup->bounds.x_min, y)
+    };
+    float* depth_row = &get_z_buffer()[get_window_width() * y];
+
+    int x = draw_depth_span(setup, &cursor, x_start, x_end, depth_row);
+    for (; x <= x_end; x++) {
+        bool is_inside = (cursor.w[0] | cursor.w[1] | cursor.w[2]) >= 0;
+        if (is_inside) {
+            float depth = 1.0 - (cursor.reciprocal_w_row + setup->reciprocal_w.dx * (x - setup->bounds.x_min));
+            if (depth < depth_row[x]) {
+                depth_row[x] = depth;
+            }
+        }
+        cursor.w[0] += setup->delta_w_col[0];
+        cursor.w[1] += setup->delta_w_col[1];
+        cursor.w[2] += setup->delta_w_col[2];
+    }
+}
 
-    // Back-face culling using the signed-area
-    if (area <= 0) {
+///////////////////////////////////////////////////////////////////////////////
+// Draw only the depth of a triangle into the z-buffer, used by the depth
+// pre-pass before the triangles are shaded with DEPTH_TEST_EQUAL
+///////////////////////////////////////////////////////////////////////////////
+void draw_depth_triangle(
+    screen_point_t* v0,
+    screen_point_t* v1,
+    screen_point_t* v2,
+    rect_t* clip
+) {
+    triangle_setup_t setup;
+    if (!setup_triangle(&setup, v0, v1, v2, clip)) {
         return;
     }
+    // Only the Hi-Z rejections are counted, the pixels are tested again by the color pass
+    raster_counts_t counts = { 0 };
+    rasterize_triangle(&setup, draw_depth_row, NULL, true, &counts);
+    add_raster_stats(&counts);
+}
 
-    // Compute the constant delta_s that will be used for the horizontal and vertical steps
-    float delta_w0_col = (v1->y - v2->y);
-    float delta_w1_col = (v2->y - v0->y);
-    float delta_w2_col = (v0->y - v1->y);
-    float delta_w0_row = (v2->x - v1->x);
-    float delta_w1_row = (v0->x - v2->x);
-    float delta_w2_row = (v1->x - v0->x);
-
-    // Rasterization fill rule, not 100% precise due to floating point innacuracy
-    float bias0 = 0; // is_top_left(&sv1, &sv2) ? 0 : -0.0001;
-    float bias1 = 0; // is_top_left(&sv2, &sv0) ? 0 : -0.0001;
-    float bias2 = 0; // is_top_left(&sv0, &sv1) ? 0 : -0.0001;
-
-    // Compute the edge functions for the fist (top-left) point
-    vec2_t p0 = { x_min + 0.5f , y_min + 0.5f };
-    float w0_row = edge_cross(&sv1, &sv2, &p0) + bias0;
-    float w1_row = edge_cross(&sv2, &sv0, &p0) + bias1;
-    float w2_row = edge_cross(&sv0, &sv1, &p0) + bias2;
-
-    // Loop all candidate pixels inside the bounding box
-    for (int y = y_min; y <= y_max; y++) {
-        float w0 = w0_row;
-        float w1 = w1_row;
-        float w2 = w2_row;
-        for (int x = x_min; x <= x_max; x++) {
-            bool is_inside = w0 >= 0 && w1 >= 0 && w2 >= 0;
-            if (is_inside) {
-                float alpha = w0 / area;
-                float beta  = w1 / area;
-                float gamma = w2 / area;
-                
-                // Variables to store the interpolated values of U, V, and also 1/w for the current pixel
-                float interpolated_u;
-                float interpolated_v;
-                float interpolated_reciprocal_w;
-
-                // Perform the interpolation of all U/w and V/w values using barycentric weights and a factor of 1/w
-                interpolated_u = (v0u / v0->w) * alpha + (v1u / v1->w) * beta + (v2u / v2->w) * gamma;
-                interpolated_v = (v0v / v0->w) * alpha + (v1v / v1->w) * beta + (v2v / v2->w) * gamma;
-
-                // Also interpolate the value of 1/w for the current pixel
-                interpolated_reciprocal_w = (1 / v0->w) * alpha + (1 / v1->w) * beta + (1 / v2->w) * gamma;
-
-                // Now we can divide back both interpolated values by 1/w
-                interpolated_u /= interpolated_reciprocal_w;
-                interpolated_v /= interpolated_reciprocal_w;
-
-                // Get the mesh texture width and height dimensions
-                int texture_width = upng_get_width(texture);
-                int texture_height = upng_get_height(texture);
+// Color of a flat-shaded triangle and the pixels its rows tested and wrote
+typedef struct {
+    uint32_t color;
+    bool counts_overdraw;
+    raster_counts_t counts;
+} filled_span_t;
 
-                // Map the UV coordinate to the full texture width and height
-                int tex_x = abs((int)(interpolated_u * texture_width)) % texture_width;
-                int tex_y = abs((int)(interpolated_v * texture_height)) % texture_height;
-
-                // Adjust 1/w so the pixels that are closer to the camera have smaller values
-                interpolated_reciprocal_w = 1.0 - interpolated_reciprocal_w;
+///////////////////////////////////////////////////////////////////////////////
+// Draw the pixels x_start..x_end of row y of a flat-shaded triangle
+///////////////////////////////////////////////////////////////////////////////
+static void draw_filled_row(void* data, triangle_setup_t* setup, int x_start, int x_end, int y) {
+    filled_span_t* span = (filled_span_t*)data;
+    uint32_t color = span->color;
+    int64_t w0 = evaluate_edge(setup, 0, x_start, y);
+    int64_t w1 = evaluate_edge(setup, 1, x_start, y);
+    int64_t w2 = evaluate_edge(setup, 2, x_start, y);
+    uint32_t* color_row = &get_color_buffer()[get_color_buffer_pitch() * y];
+    float* depth_row = &get_z_buffer()[get_window_width() * y];
+    overdraw_t* overdraw_row = span->counts_overdraw ? &get_overdraw_buffer()[get_window_width() * y] : NULL;
+
+    for (int x = x_start; x <= x_end; x++) {
+        bool is_inside = (w0 | w1 | w2) >= 0;
+        if (is_inside) {
+            // Adjust 1/w so the pixels that are closer to the camera have smaller values
+            float depth = 1.0 - evaluate_plane(setup, &setup->reciprocal_w, x, y);
+            bool is_visible = depth < depth_row[x];
+            STAT_COUNT(span->counts.num_tested_pixels, 1);
+            if (overdraw_row != NULL) {
+                count_overdraw_lanes(&overdraw_row[x], 1, is_visible);
+            }
 
-                // Only draw the pixel if the depth value is less than the one previously stored in the z-buffer
-                if (interpolated_reciprocal_w < get_zbuffer_at(x, y)) {
-                    // Draw a pixel at position (x,y) with the color that comes from the mapped texture
-                    uint32_t* texture_buffer = (uint32_t*)upng_get_buffer(texture);
-                    draw_pixel(x, y, texture_buffer[(texture_width * tex_y) + tex_x]);
+            // Only draw the pixel if the depth value is less than the one previously stored in the z-buffer
+            if (is_visible) {
+                // Draw a pixel at position (x,y) with a solid color
+                color_row[x] = color;
 
-                    // Update the z-buffer value with the 1/w of this current pixel
-                    update_zbuffer_at(x, y, interpolated_reciprocal_w);
-                }
+                // Update the z-buffer value with the 1/w of this current pixel
+                depth_row[x] = depth;
+                STAT_COUNT(span->counts.num_written_pixels, 1);
             }
-            w0 += delta_w0_col;
-            w1 += delta_w1_col;
-            w2 += delta_w2_col;
         }
-        w0_row += delta_w0_row;
-        w1_row += delta_w1_row;
-        w2_row += delta_w2_row;
+        w0 += setup->delta_w_col[0];
+        w1 += setup->delta_w_col[1];
+        w2 += setup->delta_w_col[2];
     }
 }
 
@@ -205,82 +944,17 @@ void draw_textured_triangle(
 //
 ///////////////////////////////////////////////////////////////////////////////
 void draw_filled_triangle(
-    vec4_t* v0,
-    vec4_t* v1,
-    vec4_t* v2,
-    uint32_t color
+    screen_point_t* v0,
+    screen_point_t* v1,
+    screen_point_t* v2,
+    uint32_t color,
+    rect_t* clip
 ) {
-    // Finds the bounding box with all candidate pixels
-    int x_min = floor(MIN(MIN(v0->x, v1->x), v2->x));
-    int y_min = floor(MIN(MIN(v0->y, v1->y), v2->y));
-    int x_max = ceil(MAX(MAX(v0->x, v1->x), v2->x));
-    int y_max = ceil(MAX(MAX(v0->y, v1->y), v2->y));
-
-    // Screen 2D points from vertices v0, v1, and v2
-    vec2_t sv0 = { v0->x, v0->y };
-    vec2_t sv1 = { v1->x, v1->y };
-    vec2_t sv2 = { v2->x, v2->y };
-
-    // Compute the area of the entire triangle/parallelogram
-    float area = edge_cross(&sv0, &sv1, &sv2);
-
-    // Back-face culling using the signed-area
-    if (area <= 0) {
+    triangle_setup_t setup;
+    if (!setup_triangle(&setup, v0, v1, v2, clip)) {
         return;
     }
-
-    // Compute the constant delta_s that will be used for the horizontal and vertical steps
-    float delta_w0_col = (v1->y - v2->y);
-    float delta_w1_col = (v2->y - v0->y);
-    float delta_w2_col = (v0->y - v1->y);
-    float delta_w0_row = (v2->x - v1->x);
-    float delta_w1_row = (v0->x - v2->x);
-    float delta_w2_row = (v1->x - v0->x);
-
-    // Rasterization fill rule, not 100% precise due to floating point innacuracy
-    float bias0 = 0; // is_top_left(&sv1, &sv2) ? 0 : -0.0001;
-    float bias1 = 0; // is_top_left(&sv2, &sv0) ? 0 : -0.0001;
-    float bias2 = 0; // is_top_left(&sv0, &sv1) ? 0 : -0.0001;
-
-    // Compute the edge functions for the fist (top-left) point
-    vec2_t p0 = { x_min + 0.5f , y_min + 0.5f };
-    float w0_row = edge_cross(&sv1, &sv2, &p0) + bias0;
-    float w1_row = edge_cross(&sv2, &sv0, &p0) + bias1;
-    float w2_row = edge_cross(&sv0, &sv1, &p0) + bias2;
-
-    // Loop all candidate pixels inside the bounding box
-    for (int y = y_min; y <= y_max; y++) {
-        float w0 = w0_row;
-        float w1 = w1_row;
-        float w2 = w2_row;
-        for (int x = x_min; x <= x_max; x++) {
-            bool is_inside = w0 >= 0 && w1 >= 0 && w2 >= 0;
-            if (is_inside) {
-                float alpha = w0 / area;
-                float beta  = w1 / area;
-                float gamma = w2 / area;
-                
-                // Interpolate the value of 1/w for the current pixel
-                float interpolated_reciprocal_w = (1 / v0->w) * alpha + (1 / v1->w) * beta + (1 / v2->w) * gamma;
-
-                // Adjust 1/w so the pixels that are closer to the camera have smaller values
-                interpolated_reciprocal_w = 1.0 - interpolated_reciprocal_w;
-
-                // Only draw the pixel if the depth value is less than the one previously stored in the z-buffer
-                if (interpolated_reciprocal_w < get_zbuffer_at(x, y)) {
-                    // Draw a pixel at position (x,y) with a solid color
-                    draw_pixel(x, y, color);
-
-                    // Update the z-buffer value with the 1/w of this current pixel
-                    update_zbuffer_at(x, y, interpolated_reciprocal_w);
-                }
-            }
-            w0 += delta_w0_col;
-            w1 += delta_w1_col;
-            w2 += delta_w2_col;
-        }
-        w0_row += delta_w0_row;
-        w1_row += delta_w1_row;
-        w2_row += delta_w2_row;
-    }
-}
\ No newline at end of file
+    filled_span_t span = { .color = color, .counts_overdraw = should_render_overdraw(), .counts = { 0 } };
+    rasterize_triangle(&setup, draw_filled_row, &span, true, &span.counts);
+    add_raster_stats(&span.counts);
+}
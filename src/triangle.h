@@ -5,10 +5,26 @@
 #include "texture.h"
 #include "vector.h"
 #include "upng.h"
+#include "display.h"
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 
+// Screen coordinates are snapped to 28.4 fixed-point before rasterization
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_SCALE (1 << SUBPIXEL_BITS)
+
+enum depth_test {
+    DEPTH_TEST_LESS,  // Draw pixels closer than the z-buffer and store their depth
+    DEPTH_TEST_EQUAL  // Draw pixels whose depth matches the z-buffer, after a depth pre-pass
+};
+
+enum raster_kernel {
+    RASTER_KERNEL_SCALAR,
+    RASTER_KERNEL_SSE2,
+    RASTER_KERNEL_AVX2
+};
+
 typedef struct {
     int a;
     int b;
@@ -19,15 +35,58 @@ typedef struct {
     uint32_t color;
 } face_t;
 
+// Triangle assembled by the clipper, before projection
 typedef struct {
     vec4_t points[3];
     tex2_t texcoords[3];
-    uint32_t color;
-    upng_t* texture;
 } triangle_t;
 
+// Projected vertex, with only what the rasterizers read from it
+typedef struct {
+    float x;      // Screen position, in pixels
+    float y;
+    float inv_w;  // 1/w, interpolated linearly in screen space for the depth and perspective correction
+} screen_point_t;
+
+// Compact record of a projected triangle, binned into tiles and rasterized in place.
+// Flat-shaded colors are always opaque, so the mesh index takes the place of the
+// alpha byte and the whole record fits in 64 bytes, one cache line.
+typedef struct {
+    screen_point_t points[3];
+    tex2_t texcoords[3];
+    uint32_t color : 24;      // Color without its alpha byte
+    uint32_t mesh_index : 8;  // Mesh the triangle belongs to, for its texture
+} screen_triangle_t;
+
+// Screen-space plane equation of a value interpolated across a triangle.
+// value(x, y) = origin + dx * (x - x_min) + dy * (y - y_min), at pixel centers.
+typedef struct {
+    float origin; // Value at the center of the first (top-left) candidate pixel
+    float dx;     // Change of the value for each pixel to the right
+    float dy;     // Change of the value for each pixel down
+} attribute_plane_t;
+
+// Per-triangle setup, computed once and shared by every rasterizer backend
+typedef struct {
+    rect_t bounds;                  // Candidate pixels, already clipped
+    int64_t w[3];                   // Edge functions (with fill rule bias) at the first candidate pixel
+    int64_t delta_w_col[3];         // Change of the edge functions for each pixel to the right
+    int64_t delta_w_row[3];         // Change of the edge functions for each pixel down
+    double inv_area;                // 1 / area of the triangle, in fixed-point units
+    attribute_plane_t reciprocal_w; // Plane of 1/w
+    float max_reciprocal_w;         // Largest 1/w of the three vertices, the nearest point of the triangle
+} triangle_setup_t;
+
 vec3_t get_triangle_normal(vec4_t vertices[3]);
 
+bool setup_triangle(triangle_setup_t* setup, screen_point_t* v0, screen_point_t* v1, screen_point_t* v2, rect_t* clip);
+attribute_plane_t setup_attribute_plane(triangle_setup_t* setup, float a0, float a1, float a2);
+
+void init_raster_kernel(void);
+void set_raster_kernel(int kernel);
+int get_raster_kernel(void);
+const char* get_raster_kernel_name(void);
+
 void draw_wire_triangle(
     vec2_t* v0, // Vertex 0 (screen point)
     vec2_t* v1, // Vertex 1 (screen point)
@@ -36,17 +95,27 @@ void draw_wire_triangle(
 );
 
 void draw_filled_triangle(
-    vec4_t* v0, // Vertex 0
-    vec4_t* v1, // Vertex 1
-    vec4_t* v2, // Vertex 2
-    uint32_t color
+    screen_point_t* v0, // Vertex 0
+    screen_point_t* v1, // Vertex 1
+    screen_point_t* v2, // Vertex 2
+    uint32_t color,
+    rect_t* clip // Only pixels inside this rectangle are drawn
 );
 
 void draw_textured_triangle(
-    vec4_t* v0, float v0u, float v0v, // Vertex 0, followed by its UV texture coord.
-    vec4_t* v1, float v1u, float v1v, // Vertex 1, followed by its UV texture coord.
-    vec4_t* v2, float v2u, float v2v, // Vertex 0, followed by its UV texture coord.
-    upng_t* texture
+    screen_point_t* v0, float v0u, float v0v, // Vertex 0, followed by its UV texture coord.
+    screen_point_t* v1, float v1u, float v1v, // Vertex 1, followed by its UV texture coord.
+    screen_point_t* v2, float v2u, float v2v, // Vertex 0, followed by its UV texture coord.
+    upng_t* texture,
+    int depth_test, // DEPTH_TEST_LESS, or DEPTH_TEST_EQUAL after a depth pre-pass
+    rect_t* clip // Only pixels inside this rectangle are drawn
+);
+
+void draw_depth_triangle(
+    screen_point_t* v0, // Vertex 0
+    screen_point_t* v1, // Vertex 1
+    screen_point_t* v2, // Vertex 2
+    rect_t* clip // Only pixels inside this rectangle are drawn
 );
 
 #endif
@@ -0,0 +1,30 @@
+#include "vector.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// External definitions of the inline functions declared in vector.h, used
+// whenever the compiler decides not to inline a call
+///////////////////////////////////////////////////////////////////////////////
+extern vec2_t vec2_new(float x, float y);
+extern float vec2_length(vec2_t v);
+extern vec2_t vec2_add(vec2_t a, vec2_t b);
+extern vec2_t vec2_sub(vec2_t a, vec2_t b);
+extern vec2_t vec2_mul(vec2_t v, float factor);
+extern vec2_t vec2_div(vec2_t v, float factor);
+extern float vec2_dot(vec2_t a, vec2_t b);
+extern void vec2_normalize(vec2_t* v);
+extern vec3_t vec3_new(float x, float y, float z);
+extern vec3_t vec3_clone(vec3_t* v);
+extern float vec3_length(vec3_t v);
+extern vec3_t vec3_add(vec3_t a, vec3_t b);
+extern vec3_t vec3_sub(vec3_t a, vec3_t b);
+extern vec3_t vec3_mul(vec3_t v, float factor);
+extern vec3_t vec3_div(vec3_t v, float factor);
+extern vec3_t vec3_cross(vec3_t a, vec3_t b);
+extern float vec3_dot(vec3_t a, vec3_t b);
+extern void vec3_normalize(vec3_t* v);
+extern vec3_t vec3_rotate_x(vec3_t v, float angle);
+extern vec3_t vec3_rotate_y(vec3_t v, float angle);
+extern vec3_t vec3_rotate_z(vec3_t v, float angle);
+extern vec4_t vec4_from_vec3(vec3_t v);
+extern vec3_t vec3_from_vec4(vec4_t v);
+extern vec2_t vec2_from_vec4(vec4_t v);
@@ -7,6 +7,10 @@ typedef struct {
     float x, y;
 } vec2_t;
 
+typedef struct {
+    int x, y;
+} vec2i_t;
+
 typedef struct {
     float x, y, z;
 } vec3_t;
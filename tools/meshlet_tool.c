@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <string.h>
+#include "array.h"
+#include "mesh.h"
+#include "meshlet.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Offline meshlet builder
+///////////////////////////////////////////////////////////////////////////////
+// Partitions each OBJ file into meshlets and writes them next to it, with the
+// same name and a .meshlets extension, so the renderer can load them instead
+// of clustering the faces at startup. Prints how many meshlets each file has,
+// their average size, and how many have a normal cone narrow enough to cull.
+//
+// Usage: ./meshlet_tool file.obj [file.obj ...]
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s file.obj [file.obj ...]\n", argv[0]);
+        return 1;
+    }
+
+    int result = 0;
+    for (int i = 1; i < argc; i++) {
+        mesh_t mesh;
+        memset(&mesh, 0, sizeof(mesh));
+        load_mesh_obj_data(&mesh, argv[i]);
+
+        int num_faces = array_length(mesh.faces);
+        if (num_faces == 0) {
+            fprintf(stderr, "No faces loaded from %s.\n", argv[i]);
+            result = 1;
+            continue;
+        }
+
+        build_meshlets(mesh.vertices, mesh.faces, mesh.face_planes, &mesh.meshlets, &mesh.meshlet_faces);
+
+        char meshlet_filename[1024];
+        get_meshlet_filename(argv[i], meshlet_filename, sizeof(meshlet_filename));
+        if (!save_meshlets(meshlet_filename, mesh.vertices, mesh.faces, mesh.meshlets, mesh.meshlet_faces)) {
+            fprintf(stderr, "Could not write %s.\n", meshlet_filename);
+            result = 1;
+        }
+
+        int num_meshlets = array_length(mesh.meshlets);
+        int num_cullable = 0;
+        for (int j = 0; j < num_meshlets; j++) {
+            num_cullable += mesh.meshlets[j].cone_cutoff < 1;
+        }
+        printf("%s: %d faces, %d meshlets, %.1f faces per meshlet, %d with a cullable normal cone\n",
+            meshlet_filename, num_faces, num_meshlets, (float)num_faces / num_meshlets, num_cullable);
+
+        array_free(mesh.vertices);
+        array_free(mesh.vertices_x);
+        array_free(mesh.vertices_y);
+        array_free(mesh.vertices_z);
+        array_free(mesh.faces);
+        array_free(mesh.face_planes);
+        array_free(mesh.meshlets);
+        array_free(mesh.meshlet_faces);
+    }
+    return result;
+}